@@ -9,7 +9,8 @@ in Surface{
 }fs_in;
 
 uniform sampler2D _MainTex;
-uniform sampler2D _ShadowMap;
+//Created with GL_TEXTURE_COMPARE_MODE, each tap returns 4 filtered comparisons
+uniform sampler2DShadow _ShadowMap;
 
 uniform vec3 _EyePos;
 uniform vec3 _LightPos;
@@ -29,10 +30,36 @@ struct Shadow{
 	float camSize;
 	float minBias;
 	float maxBias;
+	float filterRadius; //In texels
 };
 uniform Shadow _Shadow;
 
-float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, float bias)
+//Tap count is a compile time variant, main.cpp builds one shader per PCF_TAPS value
+#ifndef PCF_TAPS
+#define PCF_TAPS 8
+#endif
+const vec2 POISSON_DISK[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+//Per pixel rotation so the disk's pattern turns into fine noise instead of banding
+mat2 poissonRotation()
+{
+	float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	float angle = noise * 6.2831853;
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat2(c, s, -s, c);
+}
+
+float calcShadow(sampler2DShadow shadowMap, vec4 lightSpacePos, float bias)
 {
 	//Homogeneous Clip space to NDC [-w,w] to [-1,1]
     vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
@@ -41,18 +68,15 @@ float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, float bias)
 
 	float myDepth = sampleCoord.z - bias; 
 
-	float totalShadow = 0;
-	vec2 texelOffset = 1.0 /  textureSize(shadowMap,0);
-	for(int y = -1; y <=1; y++){
-		for(int x = -1; x <=1; x++)
-		{
-			vec2 uv = sampleCoord.xy + vec2(x * texelOffset.x, y * texelOffset.y);
-			totalShadow+=step(texture(shadowMap,uv).r,myDepth);
-		}
+	float lit = 0;
+	vec2 texelOffset = _Shadow.filterRadius / textureSize(shadowMap,0);
+	mat2 rotation = poissonRotation();
+	for (int i = 0; i < PCF_TAPS; i++)
+	{
+		vec2 uv = sampleCoord.xy + (rotation * POISSON_DISK[i]) * texelOffset;
+		lit += texture(shadowMap, vec3(uv, myDepth));
 	}
-	totalShadow/=9.0;
-
-	return totalShadow;
+	return 1.0 - lit / PCF_TAPS;
 }
 
 void main()
@@ -13,6 +13,8 @@ out Surface{
 	vec2 TexCoord;
 	vec4 LightSpacePos;
 }vs_out;
+//Depth must match depthOnly.vert bit for bit so the depth prepass can use GL_EQUAL
+invariant gl_Position;
 
 void main(){
 	//Transform vertex position to World Space.
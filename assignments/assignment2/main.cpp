@@ -10,7 +10,10 @@
 #include <ew/texture.h>
 #include <ew/procGen.h>
 #include <sh/framebuffer.h>
-#include <sh/shadowbuffer.h>
+#include <sh/shadowCache.h>
+#include <sh/gpuMemory.h>
+#include <sh/gpuTimer.h>
+#include <sh/textureStreamer.h>
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -31,7 +34,8 @@ ew::Transform monkeyTransform, planeTransform;
 ew::CameraController cameraController;
 ew::Camera camera, lightCamera;
 
-sh::ShadowBuffer shadowbuffer;
+//Plane shadows are drawn once, only the monkey is redrawn each frame
+sh::ShadowCache shadowCache;
 sh::FrameBuffer framebuffer;
 
 struct Material {
@@ -55,12 +59,33 @@ struct Shadow {
 	float camSize = 10.0f;
 	float minBias = 0.005f;
 	float maxBias = 0.015f;
+	bool cacheStatic = true;
+	int pcfVariant = 1; //Shader variant with 4, 8 or 16 PCF taps
+	float filterRadius = 1.5f; //In texels
 }shadowSpecs;
 
+//Debug display of the shadow map. The map itself is set up for comparisons, which ImGui can't show.
+unsigned int shadowMapView;
+
+struct Streaming {
+	int budgetMB = 16;
+	int minResidentSize = 64;
+}streamingSpecs;
+
+sh::TextureStreamer textureStreamer;
+
+//Lays down depth first so the lit pass only shades the visible fragment of each pixel
+bool depthPrepass = false;
+sh::GpuTimer gpuTimer;
+
 int main() {
 	GLFWwindow* window = initWindow("Assignment 2", screenWidth, screenHeight);
 
-	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
+	ew::Shader litShaders[3] = {
+		ew::Shader("assets/lit.vert", "assets/lit.frag", { "PCF_TAPS 4" }),
+		ew::Shader("assets/lit.vert", "assets/lit.frag", { "PCF_TAPS 8" }),
+		ew::Shader("assets/lit.vert", "assets/lit.frag", { "PCF_TAPS 16" })
+	};
 	ew::Shader postProcessingShader = ew::Shader("assets/screenQuad.vert", "assets/postProcess.frag");
 	ew::Shader shadowShader = ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag");
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
@@ -69,12 +94,16 @@ int main() {
 	monkeyTransform.position = glm::vec3(0.0f, 0.0f, 0.0f);
 	planeTransform.position = glm::vec3(0.0f, -2.0f, 0.0f);
 	
-	//Handles to OpenGL object are unsigned integers
-	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
+	//Textures are streamed, so only their coarse mips are resident until something on screen needs more
+	textureStreamer.setBudget((size_t)streamingSpecs.budgetMB * 1024 * 1024);
+	int brickTexture = textureStreamer.addTexture("assets/brick_color.jpg");
 	glEnable(GL_CULL_FACE);
 
 	//create buffers
-	shadowbuffer = sh::createShadowBuffer(2048, 2048);
+	shadowCache.create(2048, 2048, sh::ShadowMode::DEPTH_COMPARE);
+	glGenTextures(1, &shadowMapView);
+	glTextureView(shadowMapView, GL_TEXTURE_2D, shadowCache.getShadowMap(), GL_DEPTH_COMPONENT16, 0, 1, 0, 1);
+	sh::setShadowSampling(shadowMapView, sh::ShadowMode::DEPTH);
 	framebuffer = sh::createFramebuffer(screenWidth, screenHeight, (int)(GL_RGB16F));
 
 	unsigned int dummyVAO;
@@ -97,6 +126,16 @@ int main() {
 	lightCamera.orthographic = true;
 	lightCamera.orthoHeight = shadowSpecs.camSize;
 
+	//Same draw list for the depth prepass and lit passes
+	auto drawScene = [&](const ew::Shader& shader)
+	{
+		shader.setMat4("_Model", monkeyTransform.modelMatrix());
+		monkeyModel.draw();
+
+		shader.setMat4("_Model", planeTransform.modelMatrix());
+		planeMesh.draw();
+	};
+
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
 
@@ -104,22 +143,44 @@ int main() {
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
+		//STREAM TEXTURES FOR WHAT THE CAMERA CAN SEE
+		{
+			//Monkey is ~2 units across with the texture mapped once, the plane is 10x10 with one repeat
+			textureStreamer.requestForObject(brickTexture, monkeyTransform.position, 1.5f, 1.0f, camera, screenHeight);
+			textureStreamer.requestForObject(brickTexture, planeTransform.position, 7.07f, 1.41f, camera, screenHeight);
+			textureStreamer.setBudget((size_t)streamingSpecs.budgetMB * 1024 * 1024);
+			textureStreamer.setMinResidentSize(streamingSpecs.minResidentSize);
+			textureStreamer.update();
+		}
+
 		//RENDER TO SHADOW BUFFER
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, shadowbuffer.fbo);
-			glViewport(0, 0, shadowbuffer.width, shadowbuffer.height);
-			glClear(GL_DEPTH_BUFFER_BIT);
+			gpuTimer.begin("Shadow");
 			glCullFace(GL_FRONT);
-
 			shadowShader.use();
-
-			shadowShader.setMat4("_Model", monkeyTransform.modelMatrix());
-			shadowShader.setMat4("_ViewProjection", lightCamera.projectionMatrix() * lightCamera.viewMatrix());
-
-			monkeyModel.draw();
-
-			shadowShader.setMat4("_Model", planeTransform.modelMatrix());
-			planeMesh.draw();
+			glm::mat4 lightViewProj = lightCamera.projectionMatrix() * lightCamera.viewMatrix();
+			shadowShader.setMat4("_ViewProjection", lightViewProj);
+
+			if (!shadowSpecs.cacheStatic)
+				shadowCache.invalidate();
+			//Only when the light moved
+			if (shadowCache.beginStatic(lightViewProj))
+			{
+				shadowShader.setMat4("_Model", planeTransform.modelMatrix());
+				planeMesh.draw();
+				shadowCache.endStatic();
+			}
+
+			//Rotating monkey, bounded by a sphere so rotation never escapes the box
+			const float monkeyRadius = 1.5f;
+			shadowCache.addDynamicBounds(monkeyTransform.position - glm::vec3(monkeyRadius), monkeyTransform.position + glm::vec3(monkeyRadius));
+			if (shadowCache.beginDynamic())
+			{
+				shadowShader.setMat4("_Model", monkeyTransform.modelMatrix());
+				monkeyModel.draw();
+			}
+			shadowCache.endDynamic();
+			gpuTimer.end();
 		}
 		//RENDER TO FRAMEBUFFER WITH SHADOW MAP
 		{
@@ -131,16 +192,33 @@ int main() {
 			glEnable(GL_DEPTH_TEST);
 			glCullFace(GL_BACK);
 
+			if (depthPrepass)
+			{
+				gpuTimer.begin("Depth Prepass");
+				glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+				shadowShader.use();
+				shadowShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+				drawScene(shadowShader);
+				glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+				//Only the closest surface passes now, and depth is already final
+				glDepthFunc(GL_EQUAL);
+				glDepthMask(GL_FALSE);
+				gpuTimer.end();
+			}
+
 			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, brickTexture);
+			glBindTexture(GL_TEXTURE_2D, textureStreamer.getTexture(brickTexture));
 			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, shadowbuffer.shadowMap);
+			glBindTexture(GL_TEXTURE_2D, shadowCache.getShadowMap());
 
 			glActiveTexture(GL_TEXTURE0);
 			glDrawBuffer(GL_COLOR_ATTACHMENT0);
 		}
 		//USE MONKEY SHADER AND DRAW
 		{
+			gpuTimer.begin("Forward");
+			const ew::Shader& shader = litShaders[shadowSpecs.pcfVariant];
 			//Make "_MainTex" sampler2D sample from the 2D texture bound to unit 0
 			shader.use();
 			shader.setInt("_MainTex", 0);
@@ -156,21 +234,21 @@ int main() {
 			shader.setFloat("_Material.Shininess", material.Shininess);
 			shader.setFloat("_Shadow.minBias", shadowSpecs.minBias);
 			shader.setFloat("_Shadow.maxBias", shadowSpecs.maxBias);
+			shader.setFloat("_Shadow.filterRadius", shadowSpecs.filterRadius);
 
-			//transform.modelMatrix() combines translation, rotation, and scale into a 4x4 model matrix
-			shader.setMat4("_Model", monkeyTransform.modelMatrix());
 			shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
 			shader.setMat4("_LightViewProj", lightCamera.projectionMatrix() * lightCamera.viewMatrix());
 
-			monkeyModel.draw(); //Draws monkey model using current shader
-
-			shader.setMat4("_Model", planeTransform.modelMatrix());
-			planeMesh.draw();
+			drawScene(shader);
 
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
 			glBindTextureUnit(0, framebuffer.colorBuffer[0]);
+			gpuTimer.end();
 		}
 		//SWAP TO BACKGROUND AND DRAW TO FULLSCREEN QUAD USING POSTPROCESSING SHADER
 		{
+			gpuTimer.begin("Post Process");
 			glBindFramebuffer(GL_FRAMEBUFFER, 0); // back to default
 			glClearColor(0.0f, 0.4f, 0.8f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -181,7 +259,9 @@ int main() {
 			glBindVertexArray(dummyVAO);
 			glBindTexture(GL_TEXTURE_2D, framebuffer.colorBuffer[0]);
 			glDrawArrays(GL_TRIANGLES, 0, 6); //6 for quad, 3 for triangle
+			gpuTimer.end();
 		}
+		gpuTimer.endFrame();
 
 		//Rotate model around Y axis
 		monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
@@ -197,7 +277,10 @@ int main() {
 	}
 	printf("Shutting down...");
 	sh::deleteFramebuffer(framebuffer);
-	sh::deleteShadowBuffer(shadowbuffer);
+	glDeleteTextures(1, &shadowMapView);
+	shadowCache.destroy();
+	textureStreamer.destroy();
+	gpuTimer.destroy();
 }
 
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
@@ -233,6 +316,51 @@ void drawUI() {
 		ImGui::DragFloat("Shadow Cam Size", &shadowSpecs.camSize, 0.025f, 5.0f, 20.0f);
 		ImGui::DragFloat("Shadow Min Bias", &shadowSpecs.minBias, 0.000025f, 0.001f, 0.05f);
 		ImGui::DragFloat("Shadow Max Bias", &shadowSpecs.maxBias, 0.000025f, 0.015f, 0.1f);
+		const char* tapCounts[3] = { "4 taps", "8 taps", "16 taps" };
+		ImGui::Combo("PCF Taps", &shadowSpecs.pcfVariant, tapCounts, 3);
+		ImGui::SliderFloat("Filter Radius", &shadowSpecs.filterRadius, 0.5f, 4.0f);
+		ImGui::Checkbox("Cache Static Casters", &shadowSpecs.cacheStatic);
+		sh::ShadowCacheStats stats = shadowCache.getStats();
+		ImGui::Text("Static casters %s", stats.staticRedrawn ? "redrawn" : "cached");
+		ImGui::Text("Restored %.1f%%, dynamic %.1f%% of the map", 100.0f * stats.restoredTexels / stats.totalTexels, 100.0f * stats.dynamicTexels / stats.totalTexels);
+	}
+	if (ImGui::CollapsingHeader("Performance")) {
+		ImGui::Checkbox("Depth Prepass", &depthPrepass);
+		gpuTimer.drawTable();
+	}
+	if (ImGui::CollapsingHeader("Texture Streaming")) {
+		ImGui::SliderInt("VRAM Budget (MB)", &streamingSpecs.budgetMB, 1, 256);
+		ImGui::SliderInt("Min Resident Size", &streamingSpecs.minResidentSize, 1, 1024);
+
+		sh::StreamingStats stats = textureStreamer.getStats();
+		const float mb = 1.0f / (1024.0f * 1024.0f);
+		ImGui::ProgressBar((float)stats.residentBytes / stats.budgetBytes);
+		ImGui::Text("Resident: %.2f MB / %.2f MB budget", stats.residentBytes * mb, stats.budgetBytes * mb);
+		ImGui::Text("Requested: %.2f MB, full resolution: %.2f MB", stats.requestedBytes * mb, stats.fullBytes * mb);
+		ImGui::Text("Pending: %d / %d textures", stats.pendingTextures, stats.textureCount);
+		ImGui::Text("Uploads: %d, evictions: %d this frame", stats.uploadsThisFrame, stats.evictionsThisFrame);
+
+		if (ImGui::BeginTable("Streamed Textures", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("Texture");
+			ImGui::TableSetupColumn("Resident Mip");
+			ImGui::TableSetupColumn("Wanted Mip");
+			ImGui::TableSetupColumn("MB");
+			ImGui::TableHeadersRow();
+			for (int i = 0; i < textureStreamer.getTextureCount(); i++)
+			{
+				sh::StreamedTextureInfo info = textureStreamer.getTextureInfo(i);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s (%ux%u)", info.name, info.width, info.height);
+				ImGui::TableNextColumn();
+				ImGui::Text("%d (%ux%u)", info.residentMip, info.width >> info.residentMip, info.height >> info.residentMip);
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", info.requestedMip);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", info.residentBytes * mb);
+			}
+			ImGui::EndTable();
+		}
 	}
 	//Add more camera settings here!
 
@@ -245,10 +373,12 @@ void drawUI() {
 	ImVec2 windowSize = ImGui::GetWindowSize();
 	//Invert 0-1 V to flip vertically for ImGui display
 	//shadowMap is the texture2D handle
-	ImGui::Image((ImTextureID)shadowbuffer.shadowMap, windowSize, ImVec2(0, 1), ImVec2(1, 0));
+	ImGui::Image((ImTextureID)(size_t)shadowMapView, windowSize, ImVec2(0, 1), ImVec2(1, 0));
 	ImGui::EndChild();
 	ImGui::End();
 
+	sh::drawGpuMemoryWindow();
+
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -0,0 +1,92 @@
+//bilateralUpsample.frag
+#version 450
+//Joint bilateral upsample of the low resolution point lighting. Each pixel blends the 2x2 low
+//resolution texels a bilinear fetch would use, weighted down where the G-buffer texel a low
+//resolution texel was shaded from differs in depth or normal from this pixel's surface, so light
+//doesn't bleed across edges. Albedo is applied here at full resolution to keep texture detail.
+out vec4 FragColor;
+in vec2 UV;
+
+uniform layout(binding = 0) sampler2D _Lighting; //Low resolution, without albedo
+uniform layout(binding = 1) sampler2D _gNormals; //Octahedral encoded with COMPACT_GBUFFER
+uniform layout(binding = 2) sampler2D _gAlbedo;
+uniform layout(binding = 3) sampler2D _gDepth;
+
+uniform int _Downsample; //Full resolution pixels per low resolution texel, along each axis
+uniform mat4 _InverseProjection;
+uniform float _DepthTolerance = 0.05; //Fraction of the view distance
+uniform float _NormalSharpness = 16.0;
+
+vec3 octDecode(vec2 f)
+{
+	vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+vec3 readNormal(ivec2 pixel)
+{
+#ifdef COMPACT_GBUFFER
+	return octDecode(texelFetch(_gNormals, pixel, 0).xy);
+#else
+	return normalize(texelFetch(_gNormals, pixel, 0).xyz);
+#endif
+}
+
+//Positive distance in front of the camera for a depth buffer value
+float viewDistance(float depth)
+{
+	vec4 v = _InverseProjection * vec4(0.0, 0.0, depth * 2.0 - 1.0, 1.0);
+	return -v.z / v.w;
+}
+
+void main()
+{
+	ivec2 fullSize = textureSize(_gDepth, 0);
+	ivec2 lowSize = textureSize(_Lighting, 0);
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(_gDepth, pixel, 0).r;
+	//Sky, nothing was lit
+	if (depth >= 1.0)
+		discard;
+	float distance = viewDistance(depth);
+	vec3 normal = readNormal(pixel);
+
+	//This pixel in low resolution texel space, and its bilinear footprint
+	vec2 lowPos = (vec2(pixel) + 0.5) / float(_Downsample) - 0.5;
+	ivec2 base = ivec2(floor(lowPos));
+	vec2 f = lowPos - vec2(base);
+
+	vec3 total = vec3(0.0);
+	float totalWeight = 0.0;
+	//Used on its own if every texel in the footprint is across an edge
+	vec3 closest = vec3(0.0);
+	float closestWeight = -1.0;
+	for (int y = 0; y < 2; y++)
+	{
+		for (int x = 0; x < 2; x++)
+		{
+			ivec2 low = clamp(base + ivec2(x, y), ivec2(0), lowSize - 1);
+			//Same G-buffer texel the lighting pass shaded this texel from
+			ivec2 source = min(low * _Downsample + _Downsample / 2, fullSize - 1);
+			float sampleDistance = viewDistance(texelFetch(_gDepth, source, 0).r);
+			float depthWeight = exp(-abs(sampleDistance - distance) / (distance * _DepthTolerance));
+			float normalWeight = pow(max(dot(normal, readNormal(source)), 0.0), _NormalSharpness);
+			float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+			vec3 lighting = texelFetch(_Lighting, low, 0).rgb;
+			float weight = depthWeight * normalWeight;
+			total += lighting * weight * bilinear;
+			totalWeight += weight * bilinear;
+			if (weight > closestWeight)
+			{
+				closestWeight = weight;
+				closest = lighting;
+			}
+		}
+	}
+	vec3 lighting = totalWeight > 1e-4 ? total / totalWeight : closest;
+	vec3 albedo = texelFetch(_gAlbedo, pixel, 0).rgb;
+	FragColor = vec4(lighting * albedo, 0.0);
+}
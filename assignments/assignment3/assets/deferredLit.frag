@@ -2,20 +2,57 @@
 out vec4 FragColor; //The color of this fragment
 in vec2 UV;
 
-uniform sampler2D _ShadowMap;
+//One layer per cascade. Created with GL_TEXTURE_COMPARE_MODE, each tap returns 4 filtered comparisons
+uniform sampler2DArrayShadow _ShadowMap;
 
 uniform vec3 _EyePos;
 uniform vec3 _LightPos;
 uniform vec3 _LightColor = vec3(1.0);
 uniform vec3 _AmbientColor = vec3(0.3,0.4,0.46);
 
-uniform mat4 _LightViewProj; //view + projection of light source camera
+#define MAX_CASCADES 4
+uniform mat4 _CascadeViewProj[MAX_CASCADES]; //view + projection of each cascade
+uniform vec4 _CascadeSplits; //View space distance where each cascade ends
+uniform int _CascadeCount;
+uniform mat4 _View;
 
 //layout(binding = i) can be used as an alternative to shader.setInt()
 //Each sampler will always be bound to a specific texture unit
+#ifdef COMPACT_GBUFFER
+uniform layout(binding = 0) sampler2D _gDepth;
+uniform layout(binding = 1) sampler2D _gNormals; //Octahedral encoded
+uniform layout(binding = 2) sampler2D _gAlbedo;
+uniform mat4 _InverseViewProjection; //Rebuilds world position from depth
+#else
 uniform layout(binding = 0) sampler2D _gPositions;
 uniform layout(binding = 1) sampler2D _gNormals;
 uniform layout(binding = 2) sampler2D _gAlbedo;
+#endif
+
+vec3 octDecode(vec2 f)
+{
+	vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+//Reads the surface stored in the G-buffer at this UV, whichever layout it was written in
+void readGBuffer(vec2 uv, out vec3 worldPos, out vec3 worldNormal, out vec3 albedo)
+{
+#ifdef COMPACT_GBUFFER
+	float depth = texture(_gDepth,uv).r;
+	vec4 clipPos = vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	vec4 world = _InverseViewProjection * clipPos;
+	worldPos = world.xyz / world.w;
+	worldNormal = octDecode(texture(_gNormals,uv).xy);
+#else
+	worldPos = texture(_gPositions,uv).xyz;
+	worldNormal = texture(_gNormals,uv).xyz;
+#endif
+	albedo = texture(_gAlbedo,uv).rgb;
+}
 
 struct Material{
 	float Ka; //Ambient coefficient (0-1)
@@ -30,22 +67,22 @@ struct Shadow{
 	float camSize;
 	float minBias;
 	float maxBias;
+	float filterRadius; //In texels
 };
 uniform Shadow _Shadow;
 
-//Point light UBO
+//Point light SSBO, sized at runtime
 struct PointLight{
 	vec3 position;
 	float radius;
-	vec3 color;
+	vec4 color;
 };
 
-#define MAX_POINT_LIGHTS 1024
-layout (std140, binding=0) uniform AdditionalLights{
-	PointLight _PointLights[MAX_POINT_LIGHTS];
+layout (std430, binding = 0) readonly buffer PointLights{
+	PointLight _PointLights[];
 };
+uniform int _LightCount;
 
-uniform int _LightIndex; //set per light volume
 
 float attenuateExponential(float distance, float radius)
 {
@@ -64,12 +101,12 @@ vec3 calcPointLight(PointLight light, vec3 worldPos, vec3 worldNormal)
 	//Make sure fragment normal is still length 1 after interpolation.
     // diffuse
     float diffuse = max(dot(toLight, normal), 0.0);
-    vec3 diffuseFactor = _Material.Kd * diffuse * light.color;
+    vec3 diffuseFactor = _Material.Kd * diffuse * light.color.rgb;
     // specular
     vec3 viewDir = normalize(_EyePos - worldPos);
     vec3 halfwayDir = normalize(toLight + viewDir);  
     float spec = pow(max(dot(normal, halfwayDir), 0.0), _Material.Shininess);
-    vec3 specularFactor = _Material.Ks * spec * light.color; 
+    vec3 specularFactor = _Material.Ks * spec * light.color.rgb; 
 	vec3 lightColor = (diffuseFactor + specularFactor);
 
 	//Attenuation
@@ -78,8 +115,43 @@ vec3 calcPointLight(PointLight light, vec3 worldPos, vec3 worldNormal)
 	return lightColor;
 }
 
-float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, float bias)
+//Tap count is a compile time variant, main.cpp builds one shader per PCF_TAPS value
+#ifndef PCF_TAPS
+#define PCF_TAPS 8
+#endif
+const vec2 POISSON_DISK[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+//Per pixel rotation so the disk's pattern turns into fine noise instead of banding
+mat2 poissonRotation()
 {
+	float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	float angle = noise * 6.2831853;
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat2(c, s, -s, c);
+}
+
+//Picks the first cascade whose slice contains the fragment
+float calcShadow(sampler2DArrayShadow shadowMap, vec3 worldPos, float bias)
+{
+	float viewDepth = -(_View * vec4(worldPos, 1.0)).z;
+	int cascade = 0;
+	while (cascade < _CascadeCount && viewDepth > _CascadeSplits[cascade])
+		cascade++;
+	//Past the shadow distance
+	if (cascade >= _CascadeCount)
+		return 0.0;
+
+	vec4 lightSpacePos = _CascadeViewProj[cascade] * vec4(worldPos, 1.0);
 	//Homogeneous Clip space to NDC [-w,w] to [-1,1]
     vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
     //Convert from [-1,1] to [0,1]
@@ -87,27 +159,22 @@ float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, float bias)
 
 	float myDepth = sampleCoord.z - bias; 
 
-	float totalShadow = 0;
-	vec2 texelOffset = 1.0 /  textureSize(shadowMap,0);
-	for(int y = -1; y <=1; y++){
-		for(int x = -1; x <=1; x++)
-		{
-			vec2 uv = sampleCoord.xy + vec2(x * texelOffset.x, y * texelOffset.y);
-			totalShadow+=step(texture(shadowMap,uv).r,myDepth);
-		}
+	float lit = 0;
+	vec2 texelOffset = _Shadow.filterRadius / textureSize(shadowMap,0).xy;
+	mat2 rotation = poissonRotation();
+	for (int i = 0; i < PCF_TAPS; i++)
+	{
+		vec2 uv = sampleCoord.xy + (rotation * POISSON_DISK[i]) * texelOffset;
+		lit += texture(shadowMap, vec4(uv, cascade, myDepth));
 	}
-	totalShadow/=9.0;
-
-	return totalShadow;
+	return 1.0 - lit / PCF_TAPS;
 }
 
 vec3 calcDirectionalLight()
 {
 	//Sample surface properties for this screen pixel
-	vec3 worldNormal = texture(_gNormals,UV).xyz;
-	vec3 worldPos = texture(_gPositions,UV).xyz;
-	vec3 albedo = texture(_gAlbedo,UV).xyz;
-	vec4 lightSpacePos = _LightViewProj * vec4(worldPos, 1);
+	vec3 worldNormal, worldPos, albedo;
+	readGBuffer(UV, worldPos, worldNormal, albedo);
 	
 	//Usual Blinn-phong calculation
 	//Make sure fragment normal is still length 1 after interpolation.
@@ -127,7 +194,7 @@ vec3 calcDirectionalLight()
     // calculate shadow
 	//1: in shadow, 0: out of shadow
 	float bias = max(_Shadow.maxBias * (1.0 - dot(normal,_LightPos)),_Shadow.minBias);
-	float shadow = calcShadow(_ShadowMap, lightSpacePos, bias); 
+	float shadow = calcShadow(_ShadowMap, worldPos, bias); 
 	vec3 light = albedo * (ambient + (diffuse + specular) * (1.0 - shadow));
 	return light;
 }
@@ -137,14 +204,12 @@ void main()
 	/*vec3 normal = normalize(texture(_gNormals,UV).xyz);
 	vec3 totalLight = vec3(0);
 	totalLight += calcDirectionalLight();
-	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	for (int i = 0; i < _LightCount; i++)
 	{
 		totalLight += calcPointLight(_PointLights[i], texture(_gPositions,UV).xyz, normal);
 	}
 	vec3 albedo = texture(_gAlbedo,UV).xyz;
 	FragColor = vec4(albedo * totalLight, 0);*/
-	vec3 normal = normalize(texture(_gNormals,UV).xyz);
-
 	vec3 totalLight = calcDirectionalLight();
 	FragColor = vec4(totalLight, 1.0);
 }
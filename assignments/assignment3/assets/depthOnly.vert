@@ -4,6 +4,8 @@
 layout (location = 0) in vec3 vPos;
 uniform mat4 _ViewProjection;
 uniform mat4 _Model;
+//Matches lit.vert so the depth prepass can be followed by a GL_EQUAL pass
+invariant gl_Position;
 void main()
 {
     gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
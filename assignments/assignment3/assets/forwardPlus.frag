@@ -0,0 +1,201 @@
+//forwardPlus.frag
+#version 450
+//Forward+ shading. Lit once per pixel after a depth prepass: the sun with cascaded shadows, then
+//only the point lights lightTiles.comp binned into this pixel's 16x16 tile.
+out vec4 FragColor; //The color of this fragment
+
+in Surface{
+	vec3 WorldPos; //Vertex position in world space
+	vec3 WorldNormal; //Vertex normal in world space
+	vec2 TexCoord;
+	vec4 LightSpacePos;
+}fs_in;
+
+//All material textures live in layers of one array, so switching materials is just a uniform change
+uniform layout(binding = 0) sampler2DArray _MainTexArray;
+uniform int _MainTexLayer;
+uniform vec4 _MainTexST; //xy = uv scale, zw = uv offset (non-identity for atlas entries)
+uniform float _Alpha = 1.0; //Below 1 for transparent surfaces
+
+//One layer per cascade. Created with GL_TEXTURE_COMPARE_MODE, each tap returns 4 filtered comparisons
+uniform sampler2DArrayShadow _ShadowMap;
+
+uniform vec3 _EyePos;
+uniform vec3 _LightPos;
+uniform vec3 _LightColor = vec3(1.0);
+uniform vec3 _AmbientColor = vec3(0.3,0.4,0.46);
+
+#define MAX_CASCADES 4
+uniform mat4 _CascadeViewProj[MAX_CASCADES]; //view + projection of each cascade
+uniform vec4 _CascadeSplits; //View space distance where each cascade ends
+uniform int _CascadeCount;
+uniform mat4 _View;
+
+struct Material{
+	float Ka; //Ambient coefficient (0-1)
+	float Kd; //Diffuse coefficient (0-1)
+	float Ks; //Specular coefficient (0-1)
+	float Shininess; //Affects size of specular highlight
+};
+uniform Material _Material;
+
+struct Shadow{
+	float camDistance;
+	float camSize;
+	float minBias;
+	float maxBias;
+	float filterRadius; //In texels
+};
+uniform Shadow _Shadow;
+
+//Point light SSBO, sized at runtime. Same layout the deferred passes read.
+struct PointLight{
+	vec3 position;
+	float radius;
+	vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer PointLights{
+	PointLight _PointLights[];
+};
+
+//Written by lightTiles.comp, a count followed by the light indices for each tile
+#define TILE_SIZE 16
+#define TILE_STRIDE 256
+layout (std430, binding = 3) readonly buffer TileLights{
+	uint _TileLights[];
+};
+uniform int _TilesX;
+uniform bool _ShowHeatmap; //Colors each pixel by how many lights its tile loops over
+
+float attenuateExponential(float distance, float radius)
+{
+	float i = clamp(1.0 - pow(distance/radius,4.0),0.0,1.0);
+	return i * i;
+}
+
+vec3 calcPointLight(PointLight light, vec3 worldPos, vec3 normal, vec3 viewDir)
+{
+	vec3 diff = light.position - worldPos;
+	float d = length(diff); //Distance to light
+	vec3 toLight = diff / d;
+    // diffuse
+    float diffuse = max(dot(toLight, normal), 0.0);
+    vec3 diffuseFactor = _Material.Kd * diffuse * light.color.rgb;
+    // specular
+    vec3 halfwayDir = normalize(toLight + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), _Material.Shininess);
+    vec3 specularFactor = _Material.Ks * spec * light.color.rgb;
+	return (diffuseFactor + specularFactor) * attenuateExponential(d, light.radius);
+}
+
+//Cube shadow slot of each light, -1 if it has no complete shadow this frame
+layout (std430, binding = 4) readonly buffer ShadowSlots{
+	int _ShadowSlots[];
+};
+uniform layout(binding = 5) samplerCubeArrayShadow _PointShadows;
+uniform float _PointShadowBias = 0.02; //Fraction of the light's radius
+
+//1 where the light reaches, 0 where a caster in its cube shadow blocks it
+float calcPointShadow(uint lightIndex, PointLight light, vec3 worldPos)
+{
+	int slot = _ShadowSlots[lightIndex];
+	if (slot < 0)
+		return 1.0;
+	vec3 fromLight = worldPos - light.position;
+	return texture(_PointShadows, vec4(fromLight, slot), length(fromLight) / light.radius - _PointShadowBias);
+}
+
+//Tap count is a compile time variant, main.cpp builds one shader per PCF_TAPS value
+#ifndef PCF_TAPS
+#define PCF_TAPS 8
+#endif
+const vec2 POISSON_DISK[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+//Per pixel rotation so the disk's pattern turns into fine noise instead of banding
+mat2 poissonRotation()
+{
+	float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	float angle = noise * 6.2831853;
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat2(c, s, -s, c);
+}
+
+//Picks the first cascade whose slice contains the fragment
+float calcShadow(sampler2DArrayShadow shadowMap, vec3 worldPos, float bias)
+{
+	float viewDepth = -(_View * vec4(worldPos, 1.0)).z;
+	int cascade = 0;
+	while (cascade < _CascadeCount && viewDepth > _CascadeSplits[cascade])
+		cascade++;
+	//Past the shadow distance
+	if (cascade >= _CascadeCount)
+		return 0.0;
+
+	vec4 lightSpacePos = _CascadeViewProj[cascade] * vec4(worldPos, 1.0);
+	//Homogeneous Clip space to NDC [-w,w] to [-1,1]
+    vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
+    //Convert from [-1,1] to [0,1]
+    sampleCoord = sampleCoord * 0.5 + 0.5;
+
+	float myDepth = sampleCoord.z - bias; 
+
+	float lit = 0;
+	vec2 texelOffset = _Shadow.filterRadius / textureSize(shadowMap,0).xy;
+	mat2 rotation = poissonRotation();
+	for (int i = 0; i < PCF_TAPS; i++)
+	{
+		vec2 uv = sampleCoord.xy + (rotation * POISSON_DISK[i]) * texelOffset;
+		lit += texture(shadowMap, vec4(uv, cascade, myDepth));
+	}
+	return 1.0 - lit / PCF_TAPS;
+}
+
+void main()
+{
+	vec2 uv = fs_in.TexCoord * _MainTexST.xy + _MainTexST.zw;
+	vec3 albedo = texture(_MainTexArray,vec3(uv,_MainTexLayer)).rgb;
+	vec3 worldPos = fs_in.WorldPos;
+	//Make sure fragment normal is still length 1 after interpolation.
+	vec3 normal = normalize(fs_in.WorldNormal);
+	vec3 viewDir = normalize(_EyePos - worldPos);
+
+	//Directional light, same Blinn-phong as deferredLit.frag
+	vec3 ambient = _AmbientColor * _LightColor * _Material.Ka;
+	vec3 lightDir = normalize(_LightPos - worldPos);
+	float diff = max(dot(lightDir, normal), 0.0);
+	vec3 diffuse = _Material.Kd * diff * _LightColor;
+	vec3 halfwayDir = normalize(lightDir + viewDir);
+	float spec = pow(max(dot(normal, halfwayDir), 0.0), _Material.Shininess);
+	vec3 specular = _Material.Ks * spec * _LightColor;
+	float bias = max(_Shadow.maxBias * (1.0 - dot(normal,_LightPos)),_Shadow.minBias);
+	float shadow = calcShadow(_ShadowMap, worldPos, bias);
+	vec3 light = ambient + (diffuse + specular) * (1.0 - shadow);
+
+	//Point lights binned into this pixel's tile
+	ivec2 tile = ivec2(gl_FragCoord.xy) / TILE_SIZE;
+	uint tileBase = uint(tile.y * _TilesX + tile.x) * TILE_STRIDE;
+	uint lightCount = _TileLights[tileBase];
+	for (uint i = 0; i < lightCount; i++)
+	{
+		uint lightIndex = _TileLights[tileBase + 1 + i];
+		PointLight pointLight = _PointLights[lightIndex];
+		light += calcPointLight(pointLight, worldPos, normal, viewDir) * calcPointShadow(lightIndex, pointLight, worldPos);
+	}
+	if (_ShowHeatmap)
+	{
+		FragColor = vec4(mix(vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0), clamp(float(lightCount) / 64.0, 0.0, 1.0)), _Alpha);
+		return;
+	}
+	FragColor = vec4(albedo * light, _Alpha);
+}
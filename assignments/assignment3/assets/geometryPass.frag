@@ -1,8 +1,14 @@
 //geometryPass.frag 
 #version 450 core
+#ifdef COMPACT_GBUFFER
+//World position is rebuilt from depth, so only normal + albedo are written
+layout(location = 0) out vec2 gNormal; //Octahedral worldspace normal
+layout(location = 1) out vec4 gAlbedo;
+#else
 layout(location = 0) out vec3 gPosition; //Worldspace position
 layout(location = 1) out vec3 gNormal; //Worldspace normal 
 layout(location = 2) out vec3 gAlbedo;
+#endif
 
 in Surface{
 	vec3 WorldPos; 
@@ -11,9 +17,32 @@ in Surface{
 	vec4 LightSpacePos;
 }fs_in;
 
-uniform sampler2D _MainTex;
+//All material textures live in layers of one array, so switching materials is just a uniform change
+uniform layout(binding = 0) sampler2DArray _MainTexArray;
+uniform int _MainTexLayer;
+uniform vec4 _MainTexST; //xy = uv scale, zw = uv offset (non-identity for atlas entries)
+
+//Maps a unit vector onto the [-1,1] square (octahedral encoding)
+vec2 octEncode(vec3 n)
+{
+	n /= (abs(n.x) + abs(n.y) + abs(n.z));
+	if (n.z < 0.0)
+	{
+		vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+		n.xy = (1.0 - abs(n.yx)) * signs;
+	}
+	return n.xy;
+}
+
 void main(){
+	vec2 uv = fs_in.TexCoord * _MainTexST.xy + _MainTexST.zw;
+	vec3 albedo = texture(_MainTexArray,vec3(uv,_MainTexLayer)).rgb;
+#ifdef COMPACT_GBUFFER
+	gNormal = octEncode(normalize(fs_in.WorldNormal));
+	gAlbedo = vec4(albedo, 1.0);
+#else
 	gPosition = fs_in.WorldPos;
-	gAlbedo = texture(_MainTex,fs_in.TexCoord).rgb;
+	gAlbedo = albedo;
 	gNormal = normalize(fs_in.WorldNormal);
+#endif
 }
@@ -3,9 +3,29 @@
 //Vertex attributes
 layout(location = 0) in vec3 vPos;
 
-uniform mat4 _Model; 
 uniform mat4 _ViewProjection;
+uniform float _OrbRadius = 0.2;
+
+//Point light SSBO, sized at runtime
+struct PointLight{
+	vec3 position;
+	float radius;
+	vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer PointLights{
+	PointLight _PointLights[];
+};
+//Lights that survived CPU culling this frame
+layout (std430, binding = 2) readonly buffer VisibleLights{
+	uint _VisibleLights[];
+};
+
+//One instance per visible light
+flat out vec3 vs_Color;
 
 void main(){
-	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
+	PointLight light = _PointLights[_VisibleLights[gl_InstanceID]];
+	vs_Color = light.color.rgb;
+	gl_Position = _ViewProjection * vec4(light.position + vPos * _OrbRadius, 1.0);
 }
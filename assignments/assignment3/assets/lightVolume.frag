@@ -5,23 +5,57 @@ out vec4 FragColor; //The color of this fragment
 uniform vec3 _EyePos;
 //layout(binding = i) can be used as an alternative to shader.setInt()
 //Each sampler will always be bound to a specific texture unit
+#ifdef COMPACT_GBUFFER
+uniform layout(binding = 0) sampler2D _gDepth;
+uniform layout(binding = 1) sampler2D _gNormals; //Octahedral encoded
+uniform layout(binding = 2) sampler2D _gAlbedo;
+uniform mat4 _InverseViewProjection; //Rebuilds world position from depth
+#else
 uniform layout(binding = 0) sampler2D _gPositions;
 uniform layout(binding = 1) sampler2D _gNormals;
 uniform layout(binding = 2) sampler2D _gAlbedo;
+#endif
+
+vec3 octDecode(vec2 f)
+{
+	vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+//Reads the surface stored in the G-buffer at this UV, whichever layout it was written in
+void readGBuffer(vec2 uv, out vec3 worldPos, out vec3 worldNormal, out vec3 albedo)
+{
+#ifdef COMPACT_GBUFFER
+	float depth = texture(_gDepth,uv).r;
+	vec4 clipPos = vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	vec4 world = _InverseViewProjection * clipPos;
+	worldPos = world.xyz / world.w;
+	worldNormal = octDecode(texture(_gNormals,uv).xy);
+#else
+	worldPos = texture(_gPositions,uv).xyz;
+	worldNormal = texture(_gNormals,uv).xyz;
+#endif
+	albedo = texture(_gAlbedo,uv).rgb;
+}
 
-//Point light UBO
+//Point light SSBO, sized at runtime
 struct PointLight{
 	vec3 position;
 	float radius;
-	vec3 color;
+	vec4 color;
 };
 
-#define MAX_POINT_LIGHTS 1024
-layout (std140, binding = 0) uniform AdditionalLights{
-	PointLight _PointLights[MAX_POINT_LIGHTS];
+layout (std430, binding = 0) readonly buffer PointLights{
+	PointLight _PointLights[];
 };
 
-uniform int _LightIndex; //set per light volume
+flat in int vs_LightIndex; //Instance that drew this light volume
+//Above 1 the target is this many times smaller and gets only the lighting, without albedo, for
+//bilateralUpsample.frag. Each pixel shades the G-buffer texel at its center.
+uniform int _Downsample = 1;
 
 //Material uniforms
 struct Material{
@@ -49,12 +83,12 @@ vec3 calcPointLight(PointLight light, vec3 worldPos, vec3 worldNormal)
 	//Make sure fragment normal is still length 1 after interpolation.
     // diffuse
     float diffuse = max(dot(toLight, normal), 0.0);
-    vec3 diffuseFactor = _Material.Kd * diffuse * light.color;
+    vec3 diffuseFactor = _Material.Kd * diffuse * light.color.rgb;
     // specular
     vec3 viewDir = normalize(_EyePos - worldPos);
     vec3 halfwayDir = normalize(toLight + viewDir);  
     float spec = pow(max(dot(normal, halfwayDir), 0.0), _Material.Shininess);
-    vec3 specularFactor = _Material.Ks * spec * light.color; 
+    vec3 specularFactor = _Material.Ks * spec * light.color.rgb; 
 	vec3 lightColor = (diffuseFactor + specularFactor);
 
 	//Attenuation
@@ -63,15 +97,32 @@ vec3 calcPointLight(PointLight light, vec3 worldPos, vec3 worldNormal)
 	return lightColor;
 }
 
+//Cube shadow slot of each light, -1 if it has no complete shadow this frame
+layout (std430, binding = 4) readonly buffer ShadowSlots{
+	int _ShadowSlots[];
+};
+uniform layout(binding = 5) samplerCubeArrayShadow _PointShadows;
+uniform float _PointShadowBias = 0.02; //Fraction of the light's radius
+
+//1 where the light reaches, 0 where a caster in its cube shadow blocks it
+float calcPointShadow(uint lightIndex, PointLight light, vec3 worldPos)
+{
+	int slot = _ShadowSlots[lightIndex];
+	if (slot < 0)
+		return 1.0;
+	vec3 fromLight = worldPos - light.position;
+	return texture(_PointShadows, vec4(fromLight, slot), length(fromLight) / light.radius - _PointShadowBias);
+}
+
 void main(){
 	//0-1 UV for sampling gBuffers
 	//gl_FragCoord is pixel position of the fragment
-    vec2 UV = gl_FragCoord.xy / textureSize(_gNormals,0); 
+    vec2 UV = (floor(gl_FragCoord.xy) * _Downsample + float(_Downsample / 2) + 0.5) / textureSize(_gNormals,0);
 	//Calculate lighting for single point light
-	vec3 normal = texture(_gNormals,UV).xyz;
-	vec3 worldPos = texture(_gPositions,UV).xyz;
+	vec3 normal, worldPos, albedo;
+	readGBuffer(UV, worldPos, normal, albedo);
 	//Access this light's data
-	PointLight light = _PointLights[_LightIndex];
-	vec3 lightColor = calcPointLight(light, worldPos, normal);
-	FragColor = vec4(lightColor * texture(_gAlbedo,UV).rgb, 1);
+	PointLight light = _PointLights[vs_LightIndex];
+	vec3 lightColor = calcPointLight(light, worldPos, normal) * calcPointShadow(uint(vs_LightIndex), light, worldPos);
+	FragColor = vec4(_Downsample > 1 ? lightColor : lightColor * albedo, 1);
 }
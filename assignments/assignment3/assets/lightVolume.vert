@@ -1,10 +1,30 @@
 #version 450
-uniform mat4 _Model; //Model->World Matrix
 uniform mat4 _ViewProjection; //Combined View->Projection Matrix
+uniform int _InstanceOffset = 0; //First visible light of this draw, lights are drawn in depth batches
 layout(location = 0) in vec3 vPos; //Vertex position in model space
 
+//Point light SSBO, sized at runtime
+struct PointLight{
+	vec3 position;
+	float radius;
+	vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer PointLights{
+	PointLight _PointLights[];
+};
+//Lights that survived CPU culling this frame
+layout (std430, binding = 2) readonly buffer VisibleLights{
+	uint _VisibleLights[];
+};
+
+//One instance per visible light, the sphere is scaled to the light's radius
+flat out int vs_LightIndex;
+
 void main()
 {
-	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
+	int index = int(_VisibleLights[gl_InstanceID + _InstanceOffset]);
+	PointLight light = _PointLights[index];
+	vs_LightIndex = index;
+	gl_Position = _ViewProjection * vec4(light.position + vPos * light.radius, 1.0);
 }
-
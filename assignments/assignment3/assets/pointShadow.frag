@@ -0,0 +1,23 @@
+//pointShadow.frag
+#version 450
+
+in vec3 gs_WorldPos;
+
+struct PointLight{
+	vec3 position;
+	float radius;
+	vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer PointLights{
+	PointLight _PointLights[];
+};
+
+uniform int _LightIndex;
+
+void main()
+{
+	//Linear distance over the radius, so lookups don't need to know which face they land on
+	PointLight light = _PointLights[_LightIndex];
+	gl_FragDepth = length(gs_WorldPos - light.position) / light.radius;
+}
@@ -0,0 +1,10 @@
+//shadowCascades.vert
+#version 450
+
+layout (location = 0) in vec3 vPos;
+uniform mat4 _Model;
+void main()
+{
+	//World space, the geometry shader projects into each cascade
+	gl_Position = _Model * vec4(vPos, 1.0);
+}
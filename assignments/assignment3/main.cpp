@@ -1,7 +1,11 @@
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <iostream>
 #include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
 
 #include <ew/external/glad.h>
 #include <ew/shader.h>
@@ -11,8 +15,19 @@
 #include <ew/cameraController.h>
 #include <ew/texture.h>
 #include <ew/procGen.h>
+#include <ew/scene.h>
+#include <ew/threadPool.h>
+#include <ew/transformBatch.h>
 #include <sh/framebuffer.h>
-#include <sh/shadowbuffer.h>
+#include <sh/cascadedShadowMap.h>
+#include <sh/gpuMemory.h>
+#include <sh/gpuTimer.h>
+#include <sh/textureArray.h>
+#include <sh/renderGraph.h>
+#include <sh/culling.h>
+#include <sh/lightManager.h>
+#include <sh/pointShadowAtlas.h>
+#include <sh/dynamicBvh.h>
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -29,13 +44,115 @@ unsigned int screenHeight = 720;
 float prevFrameTime;
 float deltaTime;
 
-ew::Transform monkeyTransform [8][8], planeTransform;
+//Every object in the scene. World matrices are recomputed once per frame, before any pass reads them.
+ew::Scene scene;
+//Mesh ids for ew::Scene, nodes are drawn per mesh
+enum SceneMesh
+{
+	MESH_MONKEY = 0,
+	MESH_PLANE = 1,
+	MESH_TRANSPARENT_SPHERE = 2 //Alpha blended, only the forward+ path can draw them
+};
+//World bounds of every node with a mesh, camera and cascade passes only draw what it finds in their frustum
+sh::DynamicBvh sceneBvh;
+std::vector<int> nodeProxies; //Per node, -1 without a mesh
+bool cullScene = true;
+//Nodes in the camera frustum this frame, in node order
+std::vector<int> cameraVisibleNodes;
+sh::BvhCullStats cameraCullStats;
+//Shared by CPU work that splits large arrays, e.g. batched transforms
+ew::ThreadPool threadPool;
+
+//Times ew::buildTransforms against Transform::modelMatrix() one at a time over random transforms
+struct TransformBenchmark
+{
+	int count = 50000;
+	bool normals = true;
+	bool bounds = true;
+	bool hasRun = false;
+	float scalarMs = 0.0f;
+	float batchMs = 0.0f; //Calling thread only
+	float parallelMs = 0.0f; //Across threadPool
+	float maxError = 0.0f; //Largest model matrix element difference from the scalar path
+}transformBenchmark;
+float transparentAlpha = 0.35f;
 ew::CameraController cameraController;
-ew::Camera camera, lightCamera;
+ew::Camera camera;
 
-sh::ShadowBuffer shadowbuffer;
-sh::FrameBuffer framebuffer;
-sh::FrameBuffer gBuffer;
+sh::CascadedShadowMap cascadedShadows;
+//2D views of each cascade layer so ImGui can show them
+unsigned int cascadeViews[sh::MAX_CASCADES];
+sh::RenderGraph renderGraph;
+
+//Graph resources the UI wants to look at
+struct GraphTargets
+{
+	sh::ResourceHandle gBuffer[3];
+}graphTargets;
+bool showGBuffers = true;
+sh::GBufferLayout gBufferLayout = sh::GBufferLayout::STANDARD;
+//Lays down depth first so the G-buffer pass only writes the visible fragment of each pixel
+bool depthPrepass = false;
+sh::GpuTimer gpuTimer;
+//How point lights are shaded. Volumes draw a sphere per light that rereads the G-buffer,
+//tiled bins lights into 16x16 screen tiles in a compute shader and reads the G-buffer once.
+//Stochastic bins the same way but each pixel only shades one light, picked by resampling a few
+//importance sampled candidates and last frame's pick, so overlap doesn't add cost.
+enum class PointLightPath
+{
+	VOLUMES = 0,
+	TILED_COMPUTE = 1,
+	STOCHASTIC = 2
+};
+PointLightPath pointLightPath = PointLightPath::TILED_COMPUTE;
+bool showTileHeatmap = false;
+
+struct StochasticSettings
+{
+	int candidates = 8; //Lights drawn per pixel per frame
+	bool temporal = true; //Merge in last frame's reservoir
+	int maxHistory = 20; //History is capped at this many frames' worth of candidates
+}stochasticSpecs;
+//Last frame's camera, for reprojecting reservoirs
+glm::mat4 prevViewProjection = glm::mat4(1.0f);
+unsigned int lightingFrame = 0;
+
+//Light volumes draw the back faces of each sphere depth tested against the G-buffer, so pixels
+//whose surface is behind the light or that have no surface at all are rejected before shading.
+//With GL_EXT_depth_bounds_test the visible lights are also sorted by view depth and drawn in
+//batches, each bounded to its lights' depth range, which rejects surfaces in front of them too.
+struct LightVolumeSettings
+{
+	bool depthTest = true;
+	bool depthBounds = true;
+	int batchSize = 32; //Lights sharing one depth bounds range
+}lightVolumeSpecs;
+int lightVolumeBatches = 0; //Drawn last frame
+
+//GL_EXT_depth_bounds_test isn't in the core profile glad was generated for, initWindow loads it if present
+#define GL_DEPTH_BOUNDS_TEST_EXT 0x8890
+typedef void (GLAD_API_PTR* PFNGLDEPTHBOUNDSEXTPROC)(GLclampd zmin, GLclampd zmax);
+PFNGLDEPTHBOUNDSEXTPROC glDepthBoundsEXT = NULL;
+//Point lighting is low frequency, so the deferred path can shade it at a fraction of the
+//resolution and bring it back up with a joint bilateral filter guided by G-buffer depth and normals
+enum class LightingResolution
+{
+	FULL = 0,
+	HALF = 1,
+	QUARTER = 2
+};
+LightingResolution lightingResolution = LightingResolution::FULL;
+//Deferred shades from the G-buffer. Forward+ lays down depth, bins lights into 16x16 tiles in a
+//compute shader and shades each object once against its tile's list, which also works for
+//transparent surfaces and MSAA.
+enum class RenderPath
+{
+	DEFERRED = 0,
+	FORWARD_PLUS = 1
+};
+RenderPath renderPath = RenderPath::DEFERRED;
+int msaaSamples = 4; //Forward+ only
+bool drawTransparent = true; //Forward+ only, deferred has nowhere to blend them
 
 struct Material 
 {
@@ -45,6 +162,21 @@ struct Material
 	float Shininess = 128;
 }material;
 
+//Per object surface, points into the packed texture arrays instead of owning a texture handle
+struct SurfaceMaterial
+{
+	sh::MaterialTexture albedo;
+}monkeyMaterial, planeMaterial;
+
+sh::TextureArrayPacker texturePacker;
+
+void setSurfaceMaterial(const ew::Shader& shader, const SurfaceMaterial& surface)
+{
+	texturePacker.bind(0, surface.albedo.arrayIndex);
+	shader.setInt("_MainTexLayer", surface.albedo.layer);
+	shader.setVec4("_MainTexST", glm::vec4(surface.albedo.uvScale, surface.albedo.uvOffset));
+}
+
 struct Blur 
 {
 	float intensity;
@@ -58,12 +190,40 @@ struct Light
 
 struct Shadow 
 {
-	float camDistance = 32.0f;
-	float camSize = 64.0f;
+	float distance = 60.0f; //Shadows end this far from the camera
+	float splitLambda = 0.75f; //0 = uniform splits, 1 = logarithmic
+	float casterDistance = 32.0f; //How far toward the light casters are still picked up
+	int cascadeCount = sh::MAX_CASCADES;
+	int resolution = 512;
+	bool layered = true; //All cascades in one pass through a geometry shader
+	int pcfVariant = 1; //Shader variant with 4, 8 or 16 PCF taps
+	float filterRadius = 1.5f; //In texels
 	float minBias = 0.005f;
 	float maxBias = 0.015f;
+	bool cullCasters = true; //Skip casters outside each cascade's volume
+	float minCasterTexels = 1.0f; //Casters narrower than this in a cascade are skipped there
 }shadowSpecs;
 
+//Filled by the shadow pass each frame, one per cascade
+sh::CullStats shadowCullStats[sh::MAX_CASCADES];
+
+void createCascadeViews()
+{
+	for (int i = 0; i < cascadedShadows.cascadeCount; i++)
+	{
+		glGenTextures(1, &cascadeViews[i]);
+		glTextureView(cascadeViews[i], GL_TEXTURE_2D, cascadedShadows.shadowMap, GL_DEPTH_COMPONENT16, 0, 1, i, 1);
+		//The array is set up for comparisons, which ImGui can't show
+		sh::setShadowSampling(cascadeViews[i], sh::ShadowMode::DEPTH);
+	}
+}
+
+void deleteCascadeViews()
+{
+	glDeleteTextures(cascadedShadows.cascadeCount, cascadeViews);
+}
+
+//Matches the std430 PointLight struct in the shaders
 struct PointLight 
 {
 	glm::vec3 position;
@@ -71,9 +231,86 @@ struct PointLight
 	glm::vec4 color;
 };
 
-//set up point lights
-const int MAX_POINT_LIGHTS = 1024;
-PointLight pointLights[MAX_POINT_LIGHTS];
+struct PointLightSettings
+{
+	int count = 1024;
+	bool animate = true;
+	float orbitRadius = 0.75f;
+	float orbitSpeed = 1.0f;
+	bool cpuCulling = true; //Only lights the light manager finds in the view frustum are drawn or binned
+}pointLightSpecs;
+
+//Point lights only live on the GPU. restBuffer holds where each light was placed and is never
+//written again, liveBuffer is rewritten from it by lightAnimate.comp each frame and is what every
+//lighting pass reads.
+//visibleBuffer holds indices of the lights that survived CPU culling this frame, in Morton order.
+struct PointLightBuffers
+{
+	unsigned int restBuffer = 0;
+	unsigned int liveBuffer = 0;
+	unsigned int visibleBuffer = 0;
+	unsigned int shadowSlotBuffer = 0; //Cube shadow slot per light, -1 for none
+	int count = 0;
+	int visibleCount = 0;
+	int memoryId = -1;
+}pointLights;
+
+//Indexes rest positions padded by the orbit radius, so it stays conservative while lights animate
+sh::LightManager lightManager;
+std::vector<glm::vec3> lightRestPositions;
+std::vector<float> lightRadii;
+std::vector<uint32_t> visibleLights;
+float indexedOrbitRadius = -1.0f;
+//Lights a spinning monkey can reach, their cached shadow faces go stale even if the light doesn't move
+std::vector<bool> lightNearDynamicCaster;
+
+struct PointShadowSettings
+{
+	bool enabled = true;
+	int slots = 16; //Lights that can hold a cube shadow at once
+	int resolution = 256; //Per face
+	int faceBudget = 12; //Cube faces drawn per frame
+	float bias = 0.02f; //Fraction of the light's radius
+}pointShadowSpecs;
+
+//Presets over the settings that cost the most, each can still be changed on its own afterwards
+enum class QualityTier
+{
+	LOW = 0,
+	MEDIUM = 1,
+	HIGH = 2
+};
+QualityTier qualityTier = QualityTier::HIGH;
+
+void applyQualityTier(QualityTier tier)
+{
+	qualityTier = tier;
+	switch (tier)
+	{
+	case QualityTier::LOW:
+		lightingResolution = LightingResolution::QUARTER;
+		shadowSpecs.pcfVariant = 0;
+		pointShadowSpecs.faceBudget = 4;
+		msaaSamples = 1;
+		break;
+	case QualityTier::MEDIUM:
+		lightingResolution = LightingResolution::HALF;
+		shadowSpecs.pcfVariant = 1;
+		pointShadowSpecs.faceBudget = 8;
+		msaaSamples = 2;
+		break;
+	case QualityTier::HIGH: //The defaults
+		lightingResolution = LightingResolution::FULL;
+		shadowSpecs.pcfVariant = 1;
+		pointShadowSpecs.faceBudget = 12;
+		msaaSamples = 4;
+		break;
+	}
+}
+
+sh::PointShadowAtlas pointShadowAtlas;
+std::vector<sh::ShadowCandidate> shadowCandidates;
+std::vector<sh::ShadowFaceUpdate> shadowUpdates;
 
 float randomFloat(int range, int minValue)
 {
@@ -81,6 +318,158 @@ float randomFloat(int range, int minValue)
 	return pureRand;
 }
 
+//Lays count lights out in a grid over the plane with random colors
+void createPointLights(int count)
+{
+	std::vector<PointLight> lights(count);
+	int side = (int)ceilf(sqrtf((float)count));
+	float spacing = 64.0f / side;
+	for (int i = 0; i < count; i++)
+	{
+		int x = i % side;
+		int z = i / side;
+		lights[i].position = glm::vec3(-32.0f + spacing * (x + 0.5f), 0.0f, -32.0f + spacing * (z + 0.5f));
+		//Keeps the overlap per pixel about the same as the count changes
+		lights[i].radius = 1.5f * spacing;
+		lights[i].color = glm::vec4(randomFloat(256, 0) / 256.0f, randomFloat(256, 0) / 256.0f, randomFloat(256, 0) / 256.0f, 1.0f);
+	}
+	lightRestPositions.resize(count);
+	lightRadii.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		lightRestPositions[i] = lights[i].position;
+		lightRadii[i] = lights[i].radius;
+	}
+	indexedOrbitRadius = -1.0f;
+
+	size_t bytes = sizeof(PointLight) * count;
+	glCreateBuffers(1, &pointLights.restBuffer);
+	glNamedBufferStorage(pointLights.restBuffer, bytes, lights.data(), 0);
+	glCreateBuffers(1, &pointLights.liveBuffer);
+	glNamedBufferStorage(pointLights.liveBuffer, bytes, lights.data(), 0);
+	glCreateBuffers(1, &pointLights.visibleBuffer);
+	glNamedBufferStorage(pointLights.visibleBuffer, sizeof(uint32_t) * count, NULL, GL_DYNAMIC_STORAGE_BIT);
+	std::vector<int> noShadows(count, -1);
+	glCreateBuffers(1, &pointLights.shadowSlotBuffer);
+	glNamedBufferStorage(pointLights.shadowSlotBuffer, sizeof(int) * count, noShadows.data(), GL_DYNAMIC_STORAGE_BIT);
+	//Slot 0 matches "binding = 0" in the lighting shaders, slot 1 is only read by the animation,
+	//slot 2 is the visible list the lighting passes walk and slot 4 maps lights to cube shadows
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pointLights.liveBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, pointLights.restBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, pointLights.visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, pointLights.shadowSlotBuffer);
+	pointLights.count = count;
+	pointLights.visibleCount = 0;
+	pointLights.memoryId = sh::trackGpuAllocation(sh::GpuMemoryCategory::STORAGE_BUFFER, "Point Lights",
+		bytes * 2 + sizeof(uint32_t) * count + sizeof(int) * count);
+}
+
+//Per tile light lists written by lightTiles.comp and read by forwardPlus.frag. Each tile gets
+//LIGHT_TILE_STRIDE uints, a count followed by that many light indices.
+const int LIGHT_TILE_SIZE = 16;
+const int LIGHT_TILE_STRIDE = 256;
+struct LightTileBuffer
+{
+	unsigned int buffer = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+	int memoryId = -1;
+}lightTiles;
+
+//Reallocates the tile lists when the tile grid changes size
+void updateLightTiles(unsigned int width, unsigned int height)
+{
+	int tilesX = (width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	int tilesY = (height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	if (tilesX == lightTiles.tilesX && tilesY == lightTiles.tilesY)
+		return;
+	if (lightTiles.buffer)
+	{
+		glDeleteBuffers(1, &lightTiles.buffer);
+		sh::releaseGpuAllocation(lightTiles.memoryId);
+	}
+	size_t bytes = sizeof(uint32_t) * LIGHT_TILE_STRIDE * tilesX * tilesY;
+	glCreateBuffers(1, &lightTiles.buffer);
+	glNamedBufferStorage(lightTiles.buffer, bytes, NULL, 0);
+	//Slot 3 matches "binding = 3" in lightTiles.comp and forwardPlus.frag
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lightTiles.buffer);
+	lightTiles.tilesX = tilesX;
+	lightTiles.tilesY = tilesY;
+	lightTiles.memoryId = sh::trackGpuAllocation(sh::GpuMemoryCategory::STORAGE_BUFFER, "Light Tiles", bytes);
+}
+
+void deletePointLights()
+{
+	glDeleteBuffers(1, &pointLights.restBuffer);
+	glDeleteBuffers(1, &pointLights.liveBuffer);
+	glDeleteBuffers(1, &pointLights.visibleBuffer);
+	glDeleteBuffers(1, &pointLights.shadowSlotBuffer);
+	sh::releaseGpuAllocation(pointLights.memoryId);
+	pointLights = PointLightBuffers();
+}
+
+void runTransformBenchmark()
+{
+	TransformBenchmark& bench = transformBenchmark;
+	int count = bench.count;
+	std::vector<glm::vec3> positions(count), scales(count), localMin(count), localMax(count);
+	std::vector<glm::quat> rotations(count);
+	for (int i = 0; i < count; i++)
+	{
+		positions[i] = glm::vec3(rand() % 2000 - 1000, rand() % 2000 - 1000, rand() % 2000 - 1000) * 0.1f;
+		glm::vec3 axis = glm::vec3(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100) + glm::vec3(0.0f, 0.0f, 0.5f);
+		rotations[i] = glm::angleAxis((rand() % 628) * 0.01f, glm::normalize(axis));
+		scales[i] = glm::vec3(0.25f) + glm::vec3(rand() % 100, rand() % 100, rand() % 100) * 0.02f;
+		localMin[i] = glm::vec3(-1.0f, -0.5f, -1.0f);
+		localMax[i] = glm::vec3(1.0f, 1.5f, 1.0f);
+	}
+	ew::TransformBatchInput input;
+	input.positions = positions.data();
+	input.rotations = rotations.data();
+	input.scales = scales.data();
+	input.localMin = localMin.data();
+	input.localMax = localMax.data();
+	input.count = count;
+
+	std::vector<glm::mat4> scalarModels(count), batchModels(count);
+	std::vector<glm::mat3> normals(bench.normals ? count : 0);
+	std::vector<glm::vec3> worldMin(bench.bounds ? count : 0), worldMax(bench.bounds ? count : 0);
+	ew::TransformBatchOutput output;
+	output.normals = bench.normals ? normals.data() : nullptr;
+	output.worldMin = bench.bounds ? worldMin.data() : nullptr;
+	output.worldMax = bench.bounds ? worldMax.data() : nullptr;
+
+	//Best of a few runs, the first touches memory that later runs find in cache
+	auto bestTime = [&](auto&& run)
+	{
+		float best = FLT_MAX;
+		for (int r = 0; r < 5; r++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			run();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = glm::min(best, std::chrono::duration<float, std::milli>(end - start).count());
+		}
+		return best;
+	};
+	output.models = scalarModels.data();
+	bench.scalarMs = bestTime([&] { ew::buildTransformsScalar(input, output); });
+	output.models = batchModels.data();
+	bench.batchMs = bestTime([&] { ew::buildTransforms(input, output); });
+	bench.parallelMs = bestTime([&] { ew::buildTransforms(input, output, &threadPool); });
+
+	bench.maxError = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			glm::vec4 difference = glm::abs(scalarModels[i][c] - batchModels[i][c]);
+			bench.maxError = glm::max(bench.maxError, glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)));
+		}
+	}
+	bench.hasRun = true;
+}
+
 int main() 
 {
 	srand(time(NULL));
@@ -90,52 +479,107 @@ int main()
 	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
 	ew::Shader postProcessingShader = ew::Shader("assets/screenQuad.vert", "assets/postProcess.frag");
 	ew::Shader shadowShader = ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag");
-	ew::Shader gBufferShader = ew::Shader("assets/lit.vert", "assets/geometryPass.frag");
-	ew::Shader deferredShader = ew::Shader("assets/screenTri.vert", "assets/deferredLit.frag");
+	ew::Shader cascadeShader = ew::Shader("assets/shadowCascades.vert", "assets/shadowCascades.geom", "assets/depthOnly.frag", {});
+	//One variant per sh::GBufferLayout
+	ew::Shader gBufferShaders[2] = {
+		ew::Shader("assets/lit.vert", "assets/geometryPass.frag"),
+		ew::Shader("assets/lit.vert", "assets/geometryPass.frag", { "COMPACT_GBUFFER" })
+	};
+	//[G-buffer layout][PCF tap count]
+	ew::Shader deferredShaders[2][3] = {
+		{
+			ew::Shader("assets/screenTri.vert", "assets/deferredLit.frag", { "PCF_TAPS 4" }),
+			ew::Shader("assets/screenTri.vert", "assets/deferredLit.frag", { "PCF_TAPS 8" }),
+			ew::Shader("assets/screenTri.vert", "assets/deferredLit.frag", { "PCF_TAPS 16" })
+		},
+		{
+			ew::Shader("assets/screenTri.vert", "assets/deferredLit.frag", { "COMPACT_GBUFFER", "PCF_TAPS 4" }),
+			ew::Shader("assets/screenTri.vert", "assets/deferredLit.frag", { "COMPACT_GBUFFER", "PCF_TAPS 8" }),
+			ew::Shader("assets/screenTri.vert", "assets/deferredLit.frag", { "COMPACT_GBUFFER", "PCF_TAPS 16" })
+		}
+	};
+	ew::Shader tiledLightingShaders[2] = {
+		ew::Shader::createCompute("assets/tiledLighting.comp"),
+		ew::Shader::createCompute("assets/tiledLighting.comp", { "COMPACT_GBUFFER" })
+	};
+	ew::Shader stochasticLightingShaders[2] = {
+		ew::Shader::createCompute("assets/stochasticLighting.comp"),
+		ew::Shader::createCompute("assets/stochasticLighting.comp", { "COMPACT_GBUFFER" })
+	};
+	//One variant per sh::GBufferLayout
+	ew::Shader upsampleShaders[2] = {
+		ew::Shader("assets/screenTri.vert", "assets/bilateralUpsample.frag"),
+		ew::Shader("assets/screenTri.vert", "assets/bilateralUpsample.frag", { "COMPACT_GBUFFER" })
+	};
+	ew::Shader lightAnimateShader = ew::Shader::createCompute("assets/lightAnimate.comp");
+	ew::Shader pointShadowShader = ew::Shader("assets/shadowCascades.vert", "assets/pointShadow.geom", "assets/pointShadow.frag", {});
+	//Single sample and multisampled depth
+	ew::Shader lightTileShaders[2] = {
+		ew::Shader::createCompute("assets/lightTiles.comp"),
+		ew::Shader::createCompute("assets/lightTiles.comp", { "MSAA" })
+	};
+	//One variant per PCF tap count
+	ew::Shader forwardPlusShaders[3] = {
+		ew::Shader("assets/lit.vert", "assets/forwardPlus.frag", { "PCF_TAPS 4" }),
+		ew::Shader("assets/lit.vert", "assets/forwardPlus.frag", { "PCF_TAPS 8" }),
+		ew::Shader("assets/lit.vert", "assets/forwardPlus.frag", { "PCF_TAPS 16" })
+	};
 	ew::Shader lightOrbShader = ew::Shader("assets/lightOrb.vert", "assets/lightOrb.frag");
-	ew::Shader lightVolumeShader = ew::Shader("assets/lightVolume.vert", "assets/lightVolume.frag");
+	ew::Shader lightVolumeShaders[2] = {
+		ew::Shader("assets/lightVolume.vert", "assets/lightVolume.frag"),
+		ew::Shader("assets/lightVolume.vert", "assets/lightVolume.frag", { "COMPACT_GBUFFER" })
+	};
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
 	ew::Mesh planeMesh = ew::Mesh(ew::createPlane(64, 64, 5));
 	ew::Mesh sphereMesh = ew::Mesh(ew::createSphere(2.0f, 8));
+	//Unit sphere for light volumes, pushed out so its flat faces still enclose the light's radius
+	ew::Mesh lightVolumeMesh = ew::Mesh(ew::createSphere(1.05f, 16));
+	ew::Mesh transparentMesh = ew::Mesh(ew::createSphere(1.5f, 32));
 
 	for (int i = 0; i < 8; i ++)
 	{
 		for (int j = 0; j < 8; j++)
 		{
-			monkeyTransform[i][j].position = glm::vec3(float(i * 8 - 28), 0, float(j * 8 - 28));
+			ew::Transform transform;
+			transform.position = glm::vec3(float(i * 8 - 28), 0, float(j * 8 - 28));
+			scene.setMesh(scene.createNode(transform), MESH_MONKEY, monkeyModel.getBoundsMin(), monkeyModel.getBoundsMax());
 		}
 	}
+	ew::Transform planeTransform;
 	planeTransform.position = glm::vec3(0.0f, -2.0f, 0.0f);
+	scene.setMesh(scene.createNode(planeTransform), MESH_PLANE, planeMesh.getBoundsMin(), planeMesh.getBoundsMax());
+	//In the gaps between the monkeys
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			ew::Transform transform;
+			transform.position = glm::vec3(float(i * 16 - 24), 0.0f, float(j * 16 - 24));
+			scene.setMesh(scene.createNode(transform), MESH_TRANSPARENT_SPHERE, transparentMesh.getBoundsMin(), transparentMesh.getBoundsMax());
+		}
+	}
+	scene.updateWorldTransforms();
+	nodeProxies.assign(scene.getNodeCount(), -1);
+	for (int node = 0; node < scene.getNodeCount(); node++)
+	{
+		if (scene.getMesh(node) >= 0)
+			nodeProxies[node] = sceneBvh.insert(node, scene.getWorldBoundsMin(node), scene.getWorldBoundsMax(node));
+	}
 	
-	//Handles to OpenGL object are unsigned integers
-	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
+	//Pack every surface texture into arrays up front so draws only change a layer index
+	int brickTexture = texturePacker.addTexture("assets/brick_color.jpg");
+	texturePacker.build();
+	monkeyMaterial.albedo = texturePacker.getMaterialTexture(brickTexture);
+	planeMaterial.albedo = texturePacker.getMaterialTexture(brickTexture);
 	glEnable(GL_CULL_FACE);
 
 	//create buffers
-	shadowbuffer = sh::createShadowBuffer(2048, 2048);
-	framebuffer = sh::createFramebuffer(screenWidth, screenHeight, (int)(GL_RGB16F));
-	gBuffer = sh::createGBuffer(screenWidth, screenHeight);
+	cascadedShadows = sh::createCascadedShadowMap(shadowSpecs.resolution, shadowSpecs.cascadeCount, sh::ShadowMode::DEPTH_COMPARE);
+	createCascadeViews();
+	pointShadowAtlas.create(pointShadowSpecs.resolution, pointShadowSpecs.slots);
 
 	//set point lights with different positions and colors
-	for (int i = 0; i < 32; i++)
-	{
-		for (int j = 0; j < 32; j++)
-		{
-			pointLights[i + j * 32].position = glm::vec3(float(i * 2 - 27), 0, float(j * 2 - 27));
-			pointLights[i + j * 32].color = glm::vec4(randomFloat(256, 0) / 256.0f, randomFloat(256, 0) / 256.0f, randomFloat(256, 0) / 256.0f, 1.0f);
-		}
-	}
-
-	unsigned int lightsUBO;
-	glGenBuffers(1, &lightsUBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
-	//Send pointLights data to GPU.
-	//GL_DYNAMIC_DRAW is a hint that we may change this data later.
-	glBufferData(GL_UNIFORM_BUFFER, sizeof(pointLights), pointLights, GL_DYNAMIC_DRAW);
-	//Bind this UBO to slot 0 (matches "binding=0" in shader)
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, lightsUBO);
-	//Clean up by unbinding UBO
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	createPointLights(pointLightSpecs.count);
 
 	unsigned int dummyVAO;
 	glCreateVertexArrays(1, &dummyVAO);
@@ -150,190 +594,984 @@ int main()
 	camera.aspectRatio = (float)screenWidth / screenHeight;
 	camera.fov = 60.0f; //Vertical field of view, in degrees
 
-	//set lighting camera values
-	lightCamera.position = glm::vec3(10.0f, shadowSpecs.camDistance, 10.0f);
-	lightCamera.target = glm::vec3(0.0f);
-	lightCamera.aspectRatio = 1.0f;
-	lightCamera.orthographic = true;
-	lightCamera.orthoHeight = shadowSpecs.camSize;
+	//Draws a node's mesh, the caller sets _Model
+	auto drawNodeMesh = [&](int node)
+	{
+		switch (scene.getMesh(node))
+		{
+		case MESH_MONKEY:
+			monkeyModel.draw();
+			break;
+		case MESH_PLANE:
+			planeMesh.draw();
+			break;
+		case MESH_TRANSPARENT_SPHERE:
+			transparentMesh.draw();
+			break;
+		}
+	};
+	//Opaque meshes, which cast shadows and go through the depth and G-buffer passes
+	const int opaqueMeshes[2] = { MESH_MONKEY, MESH_PLANE };
 
-	while (!glfwWindowShouldClose(window)) 
+	//Same draw list for the depth prepass, G-buffer and forward passes, only what the camera sees
+	auto drawScene = [&](const ew::Shader& shader, bool withMaterials)
 	{
-		glfwPollEvents();
+		for (int mesh : opaqueMeshes)
+		{
+			if (withMaterials)
+				setSurfaceMaterial(shader, mesh == MESH_PLANE ? planeMaterial : monkeyMaterial);
+			for (int node : cameraVisibleNodes)
+			{
+				if (scene.getMesh(node) != mesh)
+					continue;
+				shader.setMat4("_Model", scene.getWorldMatrix(node));
+				drawNodeMesh(node);
+			}
+		}
+	};
+
+	//Bit c of a node's mask is set if it should be drawn into cascade c. Each cascade's volume is
+	//extended toward the light since the shadow pass clamps depth instead of clipping at the near plane.
+	sh::Frustum cascadeFrusta[sh::MAX_CASCADES];
+	std::vector<int> casterMasks;
+	std::vector<int> casterCandidates;
+	auto cullShadowCasters = [&](int firstCascade, int lastCascade)
+	{
+		casterMasks.assign(scene.getNodeCount(), 0);
+		int casterCount = 0;
+		for (int mesh : opaqueMeshes)
+			casterCount += (int)scene.getMeshNodes(mesh).size();
+		for (int c = firstCascade; c <= lastCascade; c++)
+		{
+			sh::CullStats& stats = shadowCullStats[c];
+			stats.tested = casterCount;
+			if (!shadowSpecs.cullCasters)
+			{
+				for (int mesh : opaqueMeshes)
+				{
+					for (int node : scene.getMeshNodes(mesh))
+						casterMasks[node] |= 1 << c;
+				}
+				stats.drawn = casterCount;
+				continue;
+			}
+			//Transparent spheres come back too, they don't cast
+			sceneBvh.cullFrustum(cascadeFrusta[c], casterCandidates);
+			for (int node : casterCandidates)
+			{
+				int mesh = scene.getMesh(node);
+				if (mesh != MESH_MONKEY && mesh != MESH_PLANE)
+					continue;
+				sh::BoundingSphere sphere = sh::transformBounds(scene.getLocalBoundsMin(node), scene.getLocalBoundsMax(node), scene.getWorldMatrix(node));
+				if (2.0f * sphere.radius < shadowSpecs.minCasterTexels * cascadedShadows.texelWorldSize[c])
+				{
+					stats.culledSmall++;
+					continue;
+				}
+				casterMasks[node] |= 1 << c;
+				stats.drawn++;
+			}
+			stats.culledFrustum = casterCount - stats.drawn - stats.culledSmall;
+		}
+	};
+	//Draws casters into the cascades they survived culling for. cascade < 0 means the layered
+	//path, where the geometry shader skips cascades missing from _CascadeMask.
+	auto drawShadowCasters = [&](const ew::Shader& shader, int cascade)
+	{
+		int firstCascade = cascade < 0 ? 0 : cascade;
+		int lastCascade = cascade < 0 ? cascadedShadows.cascadeCount - 1 : cascade;
+		cullShadowCasters(firstCascade, lastCascade);
+		for (int mesh : opaqueMeshes)
+		{
+			for (int node : scene.getMeshNodes(mesh))
+			{
+				const glm::mat4& model = scene.getWorldMatrix(node);
+				int mask = casterMasks[node];
+				if (mask == 0)
+					continue;
+				if (cascade < 0)
+					shader.setInt("_CascadeMask", mask);
+				shader.setMat4("_Model", model);
+				drawNodeMesh(node);
+			}
+		}
+	};
 
-		float time = (float)glfwGetTime();
-		deltaTime = time - prevFrameTime;
-		prevFrameTime = time;
+	//Sun, cascades and material, shared by the deferred and forward+ shaders. The cascade array
+	//is expected on unit 3.
+	auto setDirectionalLight = [&](const ew::Shader& shader)
+	{
+		glm::vec4 splits = glm::vec4(0.0f);
+		for (int c = 0; c < cascadedShadows.cascadeCount; c++)
+		{
+			splits[c] = cascadedShadows.splitDistances[c];
+		}
+		shader.setMat4Array("_CascadeViewProj", cascadedShadows.viewProj, cascadedShadows.cascadeCount);
+		shader.setVec4("_CascadeSplits", splits);
+		shader.setInt("_CascadeCount", cascadedShadows.cascadeCount);
+		shader.setMat4("_View", camera.viewMatrix());
+
+		shader.setInt("_ShadowMap", 3);
+
+		shader.setVec3("_EyePos", camera.position);
+		shader.setVec3("_LightPos", glm::normalize(lightSpecs.direction));
+		shader.setVec3("_LightColor", glm::vec3(lightSpecs.colour.x, lightSpecs.colour.y, lightSpecs.colour.z));
+
+		shader.setFloat("_Material.Ka", material.Ka);
+		shader.setFloat("_Material.Kd", material.Kd);
+		shader.setFloat("_Material.Ks", material.Ks);
+		shader.setFloat("_Material.Shininess", material.Shininess);
+		shader.setFloat("_Shadow.minBias", shadowSpecs.minBias);
+		shader.setFloat("_Shadow.maxBias", shadowSpecs.maxBias);
+		shader.setFloat("_Shadow.filterRadius", shadowSpecs.filterRadius);
+	};
+
+	//Casters whose bounds touch a point light's sphere. Lights are tested at their rest position
+	//padded by the orbit radius, since only the GPU knows where they are this frame.
+	auto drawPointShadowCasters = [&](const ew::Shader& shader, int light)
+	{
+		glm::vec3 center = lightRestPositions[light];
+		float radius = lightRadii[light] + pointLightSpecs.orbitRadius;
+		auto touchesLight = [&](const sh::BoundingSphere& sphere)
+		{
+			return glm::length(sphere.center - center) <= sphere.radius + radius;
+		};
+		for (int mesh : opaqueMeshes)
+		{
+			for (int node : scene.getMeshNodes(mesh))
+			{
+				const glm::mat4& model = scene.getWorldMatrix(node);
+				if (!touchesLight(sh::transformBounds(scene.getLocalBoundsMin(node), scene.getLocalBoundsMax(node), model)))
+					continue;
+				shader.setMat4("_Model", model);
+				drawNodeMesh(node);
+			}
+		}
+	};
 
+	//Every pass of the frame is declared here with the targets it reads and writes.
+	//The graph owns the screen sized targets and rebuilds them when the window resizes.
+	auto buildRenderGraph = [&]()
+	{
+		renderGraph.reset();
+		renderGraph.setSize(screenWidth, screenHeight);
+
+		//Attached as a whole array, so the graph's framebuffer for it is layered
+		sh::ResourceHandle shadowMap = renderGraph.importTexture("Cascaded Shadow Map", cascadedShadows.shadowMap,
+			cascadedShadows.resolution, cascadedShadows.resolution, GL_DEPTH_COMPONENT16);
+		//Cube map array, also attached whole. Cached faces are kept, so it's never cleared by the graph.
+		sh::ResourceHandle pointShadowMap = renderGraph.importTexture("Point Shadow Atlas", pointShadowAtlas.getTexture(),
+			pointShadowAtlas.getResolution(), pointShadowAtlas.getResolution(), GL_DEPTH_COMPONENT16);
+		sh::TextureDesc desc;
+		desc.internalFormat = GL_RGBA16F;
+		sh::ResourceHandle hdrColor = renderGraph.createTexture("HDR Color", desc);
+		sh::ResourceHandle backbuffer = renderGraph.importBackbuffer();
+
+		//ANIMATE POINT LIGHTS
+		{
+			sh::PassDesc pass;
+			pass.name = "Animate Lights";
+			//Writes the light buffer rather than a texture, so the graph can't see who reads it
+			pass.hasSideEffects = true;
+			pass.execute = [&](const sh::RenderGraph& graph)
+			{
+				if (!pointLightSpecs.animate)
+					return;
+				lightAnimateShader.use();
+				lightAnimateShader.setInt("_LightCount", pointLights.count);
+				lightAnimateShader.setFloat("_Time", (float)glfwGetTime());
+				lightAnimateShader.setFloat("_OrbitRadius", pointLightSpecs.orbitRadius);
+				lightAnimateShader.setFloat("_OrbitSpeed", pointLightSpecs.orbitSpeed);
+				lightAnimateShader.dispatch((pointLights.count + 255) / 256);
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			};
+			renderGraph.addPass(pass);
+		}
 		//RENDER TO SHADOW BUFFER
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, shadowbuffer.fbo);
-			glViewport(0, 0, shadowbuffer.width, shadowbuffer.height);
-			glClear(GL_DEPTH_BUFFER_BIT);
-			glCullFace(GL_FRONT);
+			sh::PassDesc pass;
+			pass.name = "Shadow";
+			pass.depthWrite.resource = shadowMap;
+			pass.depthWrite.load = sh::LoadOp::CLEAR;
+			pass.execute = [&](const sh::RenderGraph& graph)
+			{
+				glCullFace(GL_FRONT);
+				//Casters between the light and the cascade's near plane still need to write depth
+				glEnable(GL_DEPTH_CLAMP);
 
-			shadowShader.use();
+				for (int c = 0; c < cascadedShadows.cascadeCount; c++)
+				{
+					cascadeFrusta[c] = sh::extendTowardEye(sh::extractFrustum(cascadedShadows.viewProj[c]));
+					shadowCullStats[c] = {};
+				}
 
-			shadowShader.setMat4("_ViewProjection", lightCamera.projectionMatrix() * lightCamera.viewMatrix());
-			for (int i = 0; i < 8; i++)
+				if (shadowSpecs.layered)
+				{
+					//Geometry shader instances each triangle into every cascade's layer
+					cascadeShader.use();
+					cascadeShader.setMat4Array("_CascadeViewProj", cascadedShadows.viewProj, cascadedShadows.cascadeCount);
+					cascadeShader.setInt("_CascadeCount", cascadedShadows.cascadeCount);
+					drawShadowCasters(cascadeShader, -1);
+				}
+				else
+				{
+					//One pass per cascade through single layer framebuffers
+					GLint graphFbo = 0;
+					glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &graphFbo);
+					shadowShader.use();
+					for (int c = 0; c < cascadedShadows.cascadeCount; c++)
+					{
+						glBindFramebuffer(GL_FRAMEBUFFER, cascadedShadows.layerFbos[c]);
+						shadowShader.setMat4("_ViewProjection", cascadedShadows.viewProj[c]);
+						drawShadowCasters(shadowShader, c);
+					}
+					glBindFramebuffer(GL_FRAMEBUFFER, graphFbo);
+				}
+				glDisable(GL_DEPTH_CLAMP);
+			};
+			renderGraph.addPass(pass);
+		}
+		//RENDER POINT LIGHT SHADOWS
+		{
+			sh::PassDesc pass;
+			pass.name = "Point Shadows";
+			pass.depthWrite.resource = pointShadowMap;
+			pass.depthWrite.load = sh::LoadOp::LOAD;
+			pass.execute = [&](const sh::RenderGraph& graph)
 			{
-					for (int j = 0; j < 8; j++)
+				if (shadowUpdates.empty())
+					return;
+				glEnable(GL_DEPTH_TEST);
+				glCullFace(GL_FRONT);
+				pointShadowShader.use();
+				int resolution = (int)pointShadowAtlas.getResolution();
+				float farDepth = 1.0f;
+				//One layered draw per light, covering only the faces the scheduler picked
+				for (const sh::ShadowFaceUpdate& update : shadowUpdates)
+				{
+					for (int face = 0; face < sh::CUBE_FACES; face++)
 					{
-						shadowShader.setMat4("_Model", monkeyTransform[i][j].modelMatrix());
-						monkeyModel.draw();
+						if (update.faceMask & (1 << face))
+							glClearTexSubImage(pointShadowAtlas.getTexture(), 0, 0, 0, update.slot * sh::CUBE_FACES + face,
+								resolution, resolution, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
 					}
-			}
-
-			shadowShader.setMat4("_Model", planeTransform.modelMatrix());
-			planeMesh.draw();
+					pointShadowShader.setInt("_LightIndex", update.light);
+					pointShadowShader.setInt("_Slot", update.slot);
+					pointShadowShader.setInt("_FaceMask", update.faceMask);
+					drawPointShadowCasters(pointShadowShader, update.light);
+				}
+				glCullFace(GL_BACK);
+			};
+			renderGraph.addPass(pass);
 		}
-		//RENDER SCENE TO GBUFFER
+		if (renderPath == RenderPath::DEFERRED)
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.fbo);
-			glViewport(0, 0, gBuffer.width, gBuffer.height);
-			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			glCullFace(GL_BACK);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, brickTexture);
-
-			gBufferShader.use();
+			bool compactGBuffer = gBufferLayout == sh::GBufferLayout::COMPACT;
+			sh::GBufferFormats gFormats = sh::getGBufferFormats(gBufferLayout);
+			const char* standardNames[3] = { "G Positions", "G Normals", "G Albedo" };
+			const char* compactNames[2] = { "G Normals (Octahedral)", "G Albedo" };
+			std::vector<sh::ResourceHandle> gColors;
+			for (int i = 0; i < gFormats.colorCount; i++)
+			{
+				desc.internalFormat = gFormats.color[i];
+				gColors.push_back(renderGraph.createTexture(compactGBuffer ? compactNames[i] : standardNames[i], desc));
+			}
+			desc.internalFormat = gFormats.depth;
+			sh::ResourceHandle gDepth = renderGraph.createTexture("G Depth", desc);
+			//What the lighting passes sample on units 0-2. The compact layout reads depth in place of positions.
+			sh::ResourceHandle gSamples[3];
+			gSamples[0] = compactGBuffer ? gDepth : gColors[0];
+			gSamples[1] = compactGBuffer ? gColors[0] : gColors[1];
+			gSamples[2] = compactGBuffer ? gColors[1] : gColors[2];
+			for (int i = 0; i < 3; i++)
+			{
+				graphTargets.gBuffer[i] = gSamples[i];
+				//Shown in the UI after the frame, so they can't be aliased with later targets
+				if (showGBuffers)
+					renderGraph.markOutput(gSamples[i]);
+			}
 
-			gBufferShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-			for (int i = 0; i < 8; i++)
+			//DEPTH PREPASS
+			if (depthPrepass)
 			{
-				for (int j = 0; j < 8; j++)
+				sh::PassDesc pass;
+				pass.name = "Depth Prepass";
+				pass.depthWrite.resource = gDepth;
+				pass.depthWrite.load = sh::LoadOp::CLEAR;
+				pass.execute = [&](const sh::RenderGraph& graph)
 				{
-					gBufferShader.setMat4("_Model", monkeyTransform[i][j].modelMatrix());
-					monkeyModel.draw();
+					glEnable(GL_DEPTH_TEST);
+					glCullFace(GL_BACK);
+
+					shadowShader.use();
+					shadowShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+					drawScene(shadowShader, false);
+				};
+				renderGraph.addPass(pass);
+			}
+			//RENDER SCENE TO GBUFFER
+			{
+				sh::PassDesc pass;
+				pass.name = "G-Buffer";
+				for (sh::ResourceHandle target : gColors)
+				{
+					sh::Attachment attachment;
+					attachment.resource = target;
+					attachment.load = sh::LoadOp::CLEAR;
+					attachment.clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+					pass.colorWrites.push_back(attachment);
 				}
+				pass.depthWrite.resource = gDepth;
+				//Depth is already final after the prepass
+				pass.depthWrite.load = depthPrepass ? sh::LoadOp::LOAD : sh::LoadOp::CLEAR;
+				bool prepass = depthPrepass;
+				pass.execute = [&, prepass](const sh::RenderGraph& graph)
+				{
+					glEnable(GL_DEPTH_TEST);
+					glCullFace(GL_BACK);
+					if (prepass)
+					{
+						glDepthFunc(GL_EQUAL);
+						glDepthMask(GL_FALSE);
+					}
+					texturePacker.invalidateBindings();
+
+					const ew::Shader& gBufferShader = gBufferShaders[(int)gBufferLayout];
+					gBufferShader.use();
+
+					gBufferShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+					drawScene(gBufferShader, true);
+
+					glDepthFunc(GL_LESS);
+					glDepthMask(GL_TRUE);
+				};
+				renderGraph.addPass(pass);
 			}
+			//LIGHTING PASS
+			{
+				sh::PassDesc pass;
+				pass.name = "Deferred Lighting";
+				pass.reads = { gSamples[0], gSamples[1], gSamples[2], shadowMap };
+				//Fullscreen triangle covers every pixel, no need to clear
+				pass.colorWrites.push_back({ hdrColor, sh::LoadOp::DONT_CARE });
+				//G-buffer depth stays attached so the light passes after this one share the framebuffer.
+				//The compact layout samples depth here, so it can't be attached at the same time.
+				if (!compactGBuffer)
+					pass.depthWrite.resource = gDepth;
+				pass.execute = [&, gSamples, shadowMap](const sh::RenderGraph& graph)
+				{
+					glDisable(GL_DEPTH_TEST);
+					const ew::Shader& deferredShader = deferredShaders[(int)gBufferLayout][shadowSpecs.pcfVariant];
+					deferredShader.use();
+					deferredShader.setMat4("_InverseViewProjection", glm::inverse(camera.projectionMatrix() * camera.viewMatrix()));
+					setDirectionalLight(deferredShader);
+
+					//Bind g-buffer textures
+					glBindTextureUnit(0, graph.getTexture(gSamples[0]));
+					glBindTextureUnit(1, graph.getTexture(gSamples[1]));
+					glBindTextureUnit(2, graph.getTexture(gSamples[2]));
+					glBindTextureUnit(3, graph.getTexture(shadowMap)); //For shadow mapping
+
+					glBindVertexArray(dummyVAO);
+					glDrawArrays(GL_TRIANGLES, 0, 3);
+					glEnable(GL_DEPTH_TEST);
+				};
+				renderGraph.addPass(pass);
+			}
+			//At full resolution point lights add straight onto the directional light. Otherwise they
+			//go into their own smaller target without albedo, which is upsampled afterwards.
+			//Stochastic lighting reprojects its reservoirs per pixel, so it always runs at full resolution
+			int downsample = pointLightPath == PointLightPath::STOCHASTIC ? 1 : 1 << (int)lightingResolution;
+			sh::ResourceHandle pointLighting = hdrColor;
+			if (downsample > 1)
+			{
+				desc.internalFormat = GL_RGBA16F;
+				desc.scale = 1.0f / downsample;
+				pointLighting = renderGraph.createTexture("Point Lighting (Low Res)", desc);
+				desc.scale = 1.0f;
+			}
+			//TILED POINT LIGHTS
+			if (pointLightPath == PointLightPath::TILED_COMPUTE)
+			{
+				sh::PassDesc pass;
+				pass.name = "Tiled Lighting";
+				pass.reads = { gSamples[0], gSamples[1], gSamples[2], gDepth, pointShadowMap };
+				//Adds onto the directional light, so the previous contents are kept
+				pass.storageWrites.push_back({ pointLighting, downsample > 1 ? sh::LoadOp::CLEAR : sh::LoadOp::LOAD });
+				pass.execute = [&, gSamples, gDepth, pointLighting, pointShadowMap, downsample](const sh::RenderGraph& graph)
+				{
+					glBindTextureUnit(0, graph.getTexture(gSamples[0]));
+					glBindTextureUnit(1, graph.getTexture(gSamples[1]));
+					glBindTextureUnit(2, graph.getTexture(gSamples[2]));
+					glBindTextureUnit(3, graph.getTexture(gDepth));
+					glBindTextureUnit(5, graph.getTexture(pointShadowMap));
+					glBindImageTexture(0, graph.getTexture(pointLighting), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+
+					const ew::Shader& tiledShader = tiledLightingShaders[(int)gBufferLayout];
+					tiledShader.use();
+					tiledShader.setVec3("_EyePos", camera.position);
+					tiledShader.setMat4("_View", camera.viewMatrix());
+					tiledShader.setMat4("_InverseProjection", glm::inverse(camera.projectionMatrix()));
+					tiledShader.setMat4("_InverseViewProjection", glm::inverse(camera.projectionMatrix() * camera.viewMatrix()));
+					tiledShader.setInt("_LightCount", pointLights.visibleCount);
+					tiledShader.setInt("_ShowHeatmap", showTileHeatmap);
+					tiledShader.setFloat("_PointShadowBias", pointShadowSpecs.bias);
+					tiledShader.setInt("_Downsample", downsample);
+					tiledShader.setFloat("_Material.Ka", material.Ka);
+					tiledShader.setFloat("_Material.Kd", material.Kd);
+					tiledShader.setFloat("_Material.Ks", material.Ks);
+					tiledShader.setFloat("_Material.Shininess", material.Shininess);
+
+					unsigned int width = graph.getWidth(pointLighting);
+					unsigned int height = graph.getHeight(pointLighting);
+					tiledShader.dispatch((width + 15) / 16, (height + 15) / 16);
+				};
+				renderGraph.addPass(pass);
+			}
+			//STOCHASTIC POINT LIGHTS
+			else if (pointLightPath == PointLightPath::STOCHASTIC)
+			{
+				//Written one frame and read back the next, so they swap roles every frame
+				sh::TextureDesc reservoirDesc;
+				reservoirDesc.internalFormat = GL_RGBA32F;
+				sh::ResourceHandle reservoirs[2] = {
+					renderGraph.createPersistentTexture("Reservoirs A", reservoirDesc),
+					renderGraph.createPersistentTexture("Reservoirs B", reservoirDesc)
+				};
+				sh::PassDesc pass;
+				pass.name = "Stochastic Lighting";
+				pass.reads = { gSamples[0], gSamples[1], gSamples[2], gDepth, pointShadowMap };
+				pass.storageWrites.push_back({ hdrColor, sh::LoadOp::LOAD });
+				pass.storageWrites.push_back({ reservoirs[0], sh::LoadOp::LOAD });
+				pass.storageWrites.push_back({ reservoirs[1], sh::LoadOp::LOAD });
+				pass.execute = [&, gSamples, gDepth, hdrColor, pointShadowMap, reservoirs](const sh::RenderGraph& graph)
+				{
+					int current = lightingFrame & 1;
+					glBindTextureUnit(0, graph.getTexture(gSamples[0]));
+					glBindTextureUnit(1, graph.getTexture(gSamples[1]));
+					glBindTextureUnit(2, graph.getTexture(gSamples[2]));
+					glBindTextureUnit(3, graph.getTexture(gDepth));
+					glBindTextureUnit(5, graph.getTexture(pointShadowMap));
+					glBindImageTexture(0, graph.getTexture(hdrColor), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+					glBindImageTexture(1, graph.getTexture(reservoirs[current]), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+					glBindImageTexture(2, graph.getTexture(reservoirs[1 - current]), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+					const ew::Shader& stochasticShader = stochasticLightingShaders[(int)gBufferLayout];
+					stochasticShader.use();
+					stochasticShader.setVec3("_EyePos", camera.position);
+					stochasticShader.setMat4("_View", camera.viewMatrix());
+					stochasticShader.setMat4("_InverseProjection", glm::inverse(camera.projectionMatrix()));
+					stochasticShader.setMat4("_InverseViewProjection", glm::inverse(camera.projectionMatrix() * camera.viewMatrix()));
+					stochasticShader.setMat4("_PrevViewProjection", prevViewProjection);
+					stochasticShader.setInt("_Frame", (int)lightingFrame);
+					stochasticShader.setInt("_Candidates", stochasticSpecs.candidates);
+					stochasticShader.setInt("_MaxHistory", stochasticSpecs.maxHistory);
+					stochasticShader.setInt("_Temporal", stochasticSpecs.temporal);
+					stochasticShader.setInt("_LightCount", pointLights.visibleCount);
+					stochasticShader.setInt("_TotalLightCount", pointLights.count);
+					stochasticShader.setFloat("_PointShadowBias", pointShadowSpecs.bias);
+					stochasticShader.setFloat("_Material.Ka", material.Ka);
+					stochasticShader.setFloat("_Material.Kd", material.Kd);
+					stochasticShader.setFloat("_Material.Ks", material.Ks);
+					stochasticShader.setFloat("_Material.Shininess", material.Shininess);
+
+					unsigned int width = graph.getWidth(hdrColor);
+					unsigned int height = graph.getHeight(hdrColor);
+					stochasticShader.dispatch((width + 15) / 16, (height + 15) / 16);
+				};
+				renderGraph.addPass(pass);
+			}
+			//RENDER LIGHT VOLUMES
+			else
+			{
+				sh::PassDesc pass;
+				pass.name = "Light Volumes";
+				pass.reads = { gSamples[0], gSamples[1], gSamples[2], pointShadowMap };
+				if (downsample > 1)
+				{
+					//Full resolution depth can't be attached to the smaller target
+					pass.colorWrites.push_back({ pointLighting, sh::LoadOp::CLEAR });
+				}
+				else
+				{
+					pass.colorWrites.push_back({ hdrColor, sh::LoadOp::LOAD });
+					if (!compactGBuffer)
+						pass.depthWrite.resource = gDepth;
+				}
+				//Depth testing needs the G-buffer depth attached, which the compact layout samples instead
+				bool depthAttached = downsample == 1 && !compactGBuffer;
+				pass.execute = [&, gSamples, pointShadowMap, downsample, depthAttached](const sh::RenderGraph& graph)
+				{
+					bool depthTested = depthAttached && lightVolumeSpecs.depthTest;
+					glBindTextureUnit(0, graph.getTexture(gSamples[0]));
+					glBindTextureUnit(1, graph.getTexture(gSamples[1]));
+					glBindTextureUnit(2, graph.getTexture(gSamples[2]));
+					glBindTextureUnit(5, graph.getTexture(pointShadowMap));
+
+					const ew::Shader& lightVolumeShader = lightVolumeShaders[(int)gBufferLayout];
+					lightVolumeShader.use();
+					glEnable(GL_BLEND);
+					glBlendFunc(GL_ONE, GL_ONE); //Additive blending
+					glCullFace(GL_FRONT); //Front face culling - we want to render back faces so that the light volumes don't disappear when we enter them.
+					glDepthMask(GL_FALSE); //Disable writing to depth buffer
+					if (depthTested)
+					{
+						//A back face only passes where the surface is in front of it, so surfaces behind
+						//the light are never shaded. Clamping keeps back faces past the far plane from being
+						//clipped away, which puts them at 1.0 like the cleared background, so the test has
+						//to be strict or the sky would be shaded from empty G-buffer texels.
+						glEnable(GL_DEPTH_TEST);
+						glDepthFunc(GL_GREATER);
+						glEnable(GL_DEPTH_CLAMP);
+					}
+					else
+					{
+						glDisable(GL_DEPTH_TEST);
+					}
 
-			gBufferShader.setMat4("_Model", planeTransform.modelMatrix());
-			planeMesh.draw();
+					//Set all shader uniforms
+					lightVolumeShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+					lightVolumeShader.setVec3("_EyePos", camera.position);
+					lightVolumeShader.setMat4("_InverseViewProjection", glm::inverse(camera.projectionMatrix() * camera.viewMatrix()));
+
+					lightVolumeShader.setFloat("_Material.Ka", material.Ka);
+					lightVolumeShader.setFloat("_Material.Kd", material.Kd);
+					lightVolumeShader.setFloat("_Material.Ks", material.Ks);
+					lightVolumeShader.setFloat("_Material.Shininess", material.Shininess);
+					lightVolumeShader.setFloat("_PointShadowBias", pointShadowSpecs.bias);
+					lightVolumeShader.setInt("_Downsample", downsample);
+
+					//One instance per light, the vertex shader places and sizes it from the light buffer
+					lightVolumeBatches = 0;
+					if (depthTested && lightVolumeSpecs.depthBounds && glDepthBoundsEXT)
+					{
+						//Visible lights were sorted front to back, so each batch covers a narrow depth range
+						//and the test rejects surfaces in front of every light in it as well
+						glm::mat4 projection = camera.projectionMatrix();
+						glm::vec3 forward = glm::normalize(camera.target - camera.position);
+						float padding = pointLightSpecs.orbitRadius;
+						auto windowDepth = [&](float viewDepth)
+						{
+							viewDepth = glm::clamp(viewDepth, camera.nearPlane, camera.farPlane);
+							glm::vec4 clip = projection * glm::vec4(0.0f, 0.0f, -viewDepth, 1.0f);
+							return clip.z / clip.w * 0.5f + 0.5f;
+						};
+						glEnable(GL_DEPTH_BOUNDS_TEST_EXT);
+						int batchSize = glm::max(lightVolumeSpecs.batchSize, 1);
+						for (int first = 0; first < pointLights.visibleCount; first += batchSize)
+						{
+							int count = glm::min(batchSize, pointLights.visibleCount - first);
+							float nearest = camera.farPlane;
+							float farthest = camera.nearPlane;
+							for (int i = first; i < first + count; i++)
+							{
+								uint32_t light = visibleLights[i];
+								float depth = glm::dot(lightRestPositions[light] - camera.position, forward);
+								float reach = lightRadii[light] + padding;
+								nearest = glm::min(nearest, depth - reach);
+								farthest = glm::max(farthest, depth + reach);
+							}
+							if (farthest < camera.nearPlane || nearest > camera.farPlane)
+								continue;
+							glDepthBoundsEXT(windowDepth(nearest), windowDepth(farthest));
+							lightVolumeShader.setInt("_InstanceOffset", first);
+							lightVolumeMesh.drawInstanced(count);
+							lightVolumeBatches++;
+						}
+						glDisable(GL_DEPTH_BOUNDS_TEST_EXT);
+					}
+					else
+					{
+						lightVolumeShader.setInt("_InstanceOffset", 0);
+						lightVolumeMesh.drawInstanced(pointLights.visibleCount);
+						lightVolumeBatches = 1;
+					}
+
+					glDisable(GL_BLEND);
+					glCullFace(GL_BACK);
+					glDepthMask(GL_TRUE); //Enable writing to depth buffer
+					glEnable(GL_DEPTH_TEST);
+					glDepthFunc(GL_LESS);
+					glDisable(GL_DEPTH_CLAMP);
+				};
+				renderGraph.addPass(pass);
+			}
+			//UPSAMPLE POINT LIGHTING
+			if (downsample > 1)
+			{
+				sh::PassDesc pass;
+				pass.name = "Bilateral Upsample";
+				pass.reads = { pointLighting, gSamples[1], gSamples[2], gDepth };
+				pass.colorWrites.push_back({ hdrColor, sh::LoadOp::LOAD });
+				pass.execute = [&, pointLighting, gSamples, gDepth, downsample](const sh::RenderGraph& graph)
+				{
+					glBindTextureUnit(0, graph.getTexture(pointLighting));
+					glBindTextureUnit(1, graph.getTexture(gSamples[1]));
+					glBindTextureUnit(2, graph.getTexture(gSamples[2]));
+					glBindTextureUnit(3, graph.getTexture(gDepth));
+
+					const ew::Shader& upsampleShader = upsampleShaders[(int)gBufferLayout];
+					upsampleShader.use();
+					upsampleShader.setInt("_Downsample", downsample);
+					upsampleShader.setMat4("_InverseProjection", glm::inverse(camera.projectionMatrix()));
+					glDisable(GL_DEPTH_TEST);
+					glEnable(GL_BLEND);
+					glBlendFunc(GL_ONE, GL_ONE); //Adds onto the directional light
+					glBindVertexArray(dummyVAO);
+					glDrawArrays(GL_TRIANGLES, 0, 3);
+					glDisable(GL_BLEND);
+					glEnable(GL_DEPTH_TEST);
+				};
+				renderGraph.addPass(pass);
+			}
+			//DRAW LIGHT ORBS
+			{
+				sh::PassDesc pass;
+				pass.name = "Light Orbs";
+				pass.colorWrites.push_back({ hdrColor, sh::LoadOp::LOAD });
+				//Depth tests straight against the G-buffer depth, no blit needed
+				pass.depthWrite.resource = gDepth;
+				pass.execute = [&](const sh::RenderGraph& graph)
+				{
+					//Draw all light orbs
+					lightOrbShader.use();
+					lightOrbShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+					lightOrbShader.setFloat("_OrbRadius", 0.2f); //Whatever radius you want
+					sphereMesh.drawInstanced(pointLights.visibleCount);
+				};
+				renderGraph.addPass(pass);
+			}
 		}
-		//LIGHTING PASS
-		{
-			//if using post processing, we draw to our offscreen framebuffer
-			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
-			glViewport(0, 0, framebuffer.width, framebuffer.height);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			deferredShader.use();
-			//TODO: Set the rest of your lighting uniforms for deferredShader. (same way we did this for lit.frag)
-			deferredShader.setMat4("_LightViewProj", lightCamera.projectionMatrix() * lightCamera.viewMatrix());
-
-			deferredShader.setInt("_ShadowMap", 3);
-
-			deferredShader.setVec3("_EyePos", camera.position);
-			deferredShader.setVec3("_LightPos", glm::normalize(lightSpecs.direction));
-			deferredShader.setVec3("_LightColor", glm::vec3(lightSpecs.colour.x, lightSpecs.colour.y, lightSpecs.colour.z));
-
-			deferredShader.setFloat("_Material.Ka", material.Ka);
-			deferredShader.setFloat("_Material.Kd", material.Kd);
-			deferredShader.setFloat("_Material.Ks", material.Ks);
-			deferredShader.setFloat("_Material.Shininess", material.Shininess);
-			deferredShader.setFloat("_Shadow.minBias", shadowSpecs.minBias);
-			deferredShader.setFloat("_Shadow.maxBias", shadowSpecs.maxBias);
-
-			//Bind g-buffer textures
-			glBindTextureUnit(0, gBuffer.colorBuffer[0]);
-			glBindTextureUnit(1, gBuffer.colorBuffer[1]);
-			glBindTextureUnit(2, gBuffer.colorBuffer[2]);
-			glBindTextureUnit(3, shadowbuffer.shadowMap); //For shadow mapping
-
-			glBindVertexArray(dummyVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 3);
-		}
-		//RENDER LIGHT VOLUMES
-		{
-			lightVolumeShader.use();
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_ONE, GL_ONE); //Additive blending
-			glCullFace(GL_FRONT); //Front face culling - we want to render back faces so that the light volumes don't disappear when we enter them.
-			glDepthMask(GL_FALSE); //Disable writing to depth buffer
-			glDisable(GL_DEPTH_TEST);
-
-			//Set all shader uniforms
-			lightVolumeShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-			//TODO: Set all shader uniforms needed for lighting - Material props, camera position,etc. Same as fullscreen quad.
-			lightVolumeShader.setVec3("_EyePos", camera.position);
-
-			lightVolumeShader.setFloat("_Material.Ka", material.Ka);
-			lightVolumeShader.setFloat("_Material.Kd", material.Kd);
-			lightVolumeShader.setFloat("_Material.Ks", material.Ks);
-			lightVolumeShader.setFloat("_Material.Shininess", material.Shininess);
-
-			//Set point light uniforms
-			/*for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
-				//Creates prefix "_PointLights[0]." etc
-				std::string prefix = "_PointLights[" + std::to_string(i) + "].";
-				lightVolumeShader.setVec3(prefix + "position", pointLights[i].position);
-				lightVolumeShader.setVec3(prefix + "color", pointLights[i].color);
-				lightVolumeShader.setFloat(prefix + "radius", pointLights[i].radius);
-			}*/
-
-			for (int i = 0; i < MAX_POINT_LIGHTS; i++)
-			{
-				//Used to access light uniform buffer
-				lightVolumeShader.setInt("_LightIndex", i);
-				glm::mat4 m = glm::mat4(1.0f);
-				m = glm::translate(m, pointLights[i].position);
-				m = glm::scale(m, glm::vec3(pointLights[i].radius));
-				lightVolumeShader.setMat4("_Model", m);
-				sphereMesh.draw();
-			}
-
-			glDisable(GL_BLEND);
-			glCullFace(GL_BACK);
-			glDepthMask(GL_TRUE); //Enable writing to depth buffer
-			glEnable(GL_DEPTH_TEST);
-		}
-		//DRAW LIGHT ORBS
-		{
-			//Blit gBuffer depth to same framebuffer as fullscreen quad
-			glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer.fbo); //Read from gBuffer 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer.fbo); //Write to current fbo
-			glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-
-			//Draw all light orbs
-			lightOrbShader.use();
-			lightOrbShader.setMat4("_ViewProjection", camera.projectionMatrix()* camera.viewMatrix());
-			for (int i = 0; i < MAX_POINT_LIGHTS; i++)
-			{
-				glm::mat4 m = glm::mat4(1.0f);
-				m = glm::translate(m, pointLights[i].position);
-				m = glm::scale(m, glm::vec3(0.2f)); //Whatever radius you want
-
-				lightOrbShader.setMat4("_Model", m);
-				lightOrbShader.setVec3("_Color", glm::vec3(pointLights[i].color.r, pointLights[i].color.g, pointLights[i].color.b));
-				sphereMesh.draw();
+		else
+		{
+			//Same depth as the deferred path's prepass, but multisampled along with the color target
+			bool multisampled = msaaSamples > 1;
+			bool transparent = drawTransparent;
+			sh::TextureDesc forwardDesc;
+			forwardDesc.samples = msaaSamples;
+			forwardDesc.internalFormat = GL_DEPTH_COMPONENT32F;
+			sh::ResourceHandle forwardDepth = renderGraph.createTexture("Forward Depth", forwardDesc);
+			//Multisampled shading goes into its own target and is resolved into hdrColor afterwards
+			sh::ResourceHandle forwardColor = hdrColor;
+			if (multisampled)
+			{
+				forwardDesc.internalFormat = GL_RGBA16F;
+				forwardColor = renderGraph.createTexture("HDR Color (MSAA)", forwardDesc);
+			}
+
+			//FORWARD DEPTH PREPASS
+			{
+				sh::PassDesc pass;
+				pass.name = "Forward Depth Prepass";
+				pass.depthWrite.resource = forwardDepth;
+				pass.depthWrite.load = sh::LoadOp::CLEAR;
+				pass.execute = [&](const sh::RenderGraph& graph)
+				{
+					glEnable(GL_DEPTH_TEST);
+					glCullFace(GL_BACK);
+
+					shadowShader.use();
+					shadowShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+					drawScene(shadowShader, false);
+				};
+				renderGraph.addPass(pass);
+			}
+			//BIN POINT LIGHTS INTO TILES
+			{
+				sh::PassDesc pass;
+				pass.name = "Light Tiles";
+				pass.reads = { forwardDepth };
+				//Writes the tile lists rather than a texture, so the graph can't see who reads them
+				pass.hasSideEffects = true;
+				pass.execute = [&, forwardDepth, multisampled, transparent](const sh::RenderGraph& graph)
+				{
+					unsigned int width = graph.getWidth(forwardDepth);
+					unsigned int height = graph.getHeight(forwardDepth);
+					updateLightTiles(width, height);
+					glBindTextureUnit(0, graph.getTexture(forwardDepth));
+
+					const ew::Shader& tileShader = lightTileShaders[multisampled ? 1 : 0];
+					tileShader.use();
+					tileShader.setMat4("_View", camera.viewMatrix());
+					tileShader.setMat4("_InverseProjection", glm::inverse(camera.projectionMatrix()));
+					tileShader.setInt("_LightCount", pointLights.visibleCount);
+					tileShader.setInt("_TilesX", lightTiles.tilesX);
+					tileShader.setInt("_Samples", msaaSamples);
+					tileShader.setInt("_IncludeTransparent", transparent);
+					tileShader.dispatch(lightTiles.tilesX, lightTiles.tilesY);
+					glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+				};
+				renderGraph.addPass(pass);
+			}
+			//FORWARD+ SHADING
+			int forwardPass;
+			{
+				sh::PassDesc pass;
+				pass.name = "Forward+";
+				pass.reads = { shadowMap, pointShadowMap };
+				sh::Attachment color;
+				color.resource = forwardColor;
+				color.load = sh::LoadOp::CLEAR;
+				color.clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+				pass.colorWrites.push_back(color);
+				pass.depthWrite.resource = forwardDepth;
+				pass.execute = [&, shadowMap, pointShadowMap, transparent](const sh::RenderGraph& graph)
+				{
+					glEnable(GL_DEPTH_TEST);
+					glCullFace(GL_BACK);
+					//Depth is final after the prepass, so every pixel is only shaded once
+					glDepthFunc(GL_EQUAL);
+					glDepthMask(GL_FALSE);
+					texturePacker.invalidateBindings();
+					glBindTextureUnit(3, graph.getTexture(shadowMap));
+					glBindTextureUnit(5, graph.getTexture(pointShadowMap));
+
+					const ew::Shader& forwardShader = forwardPlusShaders[shadowSpecs.pcfVariant];
+					forwardShader.use();
+					setDirectionalLight(forwardShader);
+					forwardShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+					forwardShader.setInt("_TilesX", lightTiles.tilesX);
+					forwardShader.setInt("_ShowHeatmap", showTileHeatmap);
+					forwardShader.setFloat("_PointShadowBias", pointShadowSpecs.bias);
+					forwardShader.setFloat("_Alpha", 1.0f);
+					drawScene(forwardShader, true);
+
+					glDepthFunc(GL_LESS);
+					glDepthMask(GL_TRUE);
+
+					lightOrbShader.use();
+					lightOrbShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
+					lightOrbShader.setFloat("_OrbRadius", 0.2f);
+					sphereMesh.drawInstanced(pointLights.visibleCount);
+
+					if (!transparent)
+						return;
+					//Back to front so each sphere blends over everything behind it
+					std::vector<int> order;
+					for (int node : cameraVisibleNodes)
+					{
+						if (scene.getMesh(node) == MESH_TRANSPARENT_SPHERE)
+							order.push_back(node);
+					}
+					auto distance = [&](int node) { return glm::length(glm::vec3(scene.getWorldMatrix(node)[3]) - camera.position); };
+					std::sort(order.begin(), order.end(), [&](int a, int b) { return distance(a) > distance(b); });
+
+					glEnable(GL_BLEND);
+					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+					glDepthMask(GL_FALSE);
+					forwardShader.use();
+					forwardShader.setFloat("_Alpha", transparentAlpha);
+					setSurfaceMaterial(forwardShader, monkeyMaterial);
+					for (int node : order)
+					{
+						forwardShader.setMat4("_Model", scene.getWorldMatrix(node));
+						drawNodeMesh(node);
+					}
+					glDisable(GL_BLEND);
+					glDepthMask(GL_TRUE);
+				};
+				forwardPass = renderGraph.addPass(pass);
+			}
+			//RESOLVE MSAA
+			if (multisampled)
+			{
+				sh::PassDesc pass;
+				pass.name = "MSAA Resolve";
+				pass.reads = { forwardColor };
+				pass.colorWrites.push_back({ hdrColor, sh::LoadOp::DONT_CARE });
+				pass.execute = [&, forwardPass, hdrColor](const sh::RenderGraph& graph)
+				{
+					//Blits from the forward pass's framebuffer, which has the multisampled color attached
+					GLint graphFbo = 0;
+					glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &graphFbo);
+					int width = (int)graph.getWidth(hdrColor);
+					int height = (int)graph.getHeight(hdrColor);
+					glBlitNamedFramebuffer(graph.getPassFramebuffer(forwardPass), graphFbo,
+						0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+				};
+				renderGraph.addPass(pass);
 			}
 		}
 		//SWAP TO BACKGROUND AND DRAW TO FULLSCREEN QUAD USING POSTPROCESSING SHADER
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, 0); // back to default
-			glClearColor(0.0f, 0.4f, 0.8f, 1.0f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
+			sh::PassDesc pass;
+			pass.name = "Post Process";
+			pass.reads = { hdrColor };
+			pass.colorWrites.push_back({ backbuffer, sh::LoadOp::DONT_CARE });
+			pass.execute = [&, hdrColor](const sh::RenderGraph& graph)
+			{
+				glDisable(GL_DEPTH_TEST);
 
-			postProcessingShader.use();
-			postProcessingShader.setFloat("_Blur.intensity", blur.intensity);
+				postProcessingShader.use();
+				postProcessingShader.setFloat("_Blur.intensity", blur.intensity);
 
-			glBindVertexArray(dummyVAO);
-			glBindTexture(GL_TEXTURE_2D, framebuffer.colorBuffer[0]);
-			glDrawArrays(GL_TRIANGLES, 0, 6); //6 for quad, 3 for triangle
+				glBindVertexArray(dummyVAO);
+				glBindTextureUnit(0, graph.getTexture(hdrColor));
+				glDrawArrays(GL_TRIANGLES, 0, 6); //6 for quad, 3 for triangle
+				glEnable(GL_DEPTH_TEST);
+			};
+			renderGraph.addPass(pass);
 		}
+		renderGraph.compile();
+	};
+	buildRenderGraph();
+	renderGraph.setTimer(&gpuTimer);
+	bool builtWithGBuffers = showGBuffers;
+	sh::GBufferLayout builtWithLayout = gBufferLayout;
+	bool builtWithPrepass = depthPrepass;
+	PointLightPath builtWithLightPath = pointLightPath;
+	RenderPath builtWithRenderPath = renderPath;
+	int builtWithSamples = msaaSamples;
+	bool builtWithTransparent = drawTransparent;
+	LightingResolution builtWithLightingResolution = lightingResolution;
+
+	while (!glfwWindowShouldClose(window)) 
+	{
+		glfwPollEvents();
+
+		float time = (float)glfwGetTime();
+		deltaTime = time - prevFrameTime;
+		prevFrameTime = time;
+
+		//Only what moved since last frame is recomputed, every pass below reads the result
+		scene.updateWorldTransforms();
+		//Most moves stay inside the proxy's fattened box and leave the tree alone
+		for (int node = 0; node < scene.getNodeCount(); node++)
+		{
+			if (nodeProxies[node] >= 0 && scene.wasUpdated(node))
+				sceneBvh.update(nodeProxies[node], scene.getWorldBoundsMin(node), scene.getWorldBoundsMax(node));
+		}
+
+		//The graph imports the cascade array, so recreating it means rebuilding the graph
+		//Same for the point shadow atlas
+		bool pointShadowsChanged = pointShadowAtlas.getSlotCount() != pointShadowSpecs.slots || (int)pointShadowAtlas.getResolution() != pointShadowSpecs.resolution;
+		if (pointShadowsChanged)
+		{
+			pointShadowAtlas.destroy();
+			pointShadowAtlas.create(pointShadowSpecs.resolution, pointShadowSpecs.slots);
+			//Every light loses its slot
+			int noShadow = -1;
+			glClearNamedBufferData(pointLights.shadowSlotBuffer, GL_R32I, GL_RED_INTEGER, GL_INT, &noShadow);
+		}
+		bool cascadesChanged = cascadedShadows.cascadeCount != shadowSpecs.cascadeCount || (int)cascadedShadows.resolution != shadowSpecs.resolution;
+		if (cascadesChanged)
+		{
+			deleteCascadeViews();
+			sh::deleteCascadedShadowMap(cascadedShadows);
+			cascadedShadows = sh::createCascadedShadowMap(shadowSpecs.resolution, shadowSpecs.cascadeCount, sh::ShadowMode::DEPTH_COMPARE);
+			createCascadeViews();
+		}
+		if (cascadesChanged || pointShadowsChanged || builtWithGBuffers != showGBuffers || builtWithLayout != gBufferLayout || builtWithPrepass != depthPrepass || builtWithLightPath != pointLightPath
+			|| builtWithRenderPath != renderPath || builtWithSamples != msaaSamples || builtWithTransparent != drawTransparent
+			|| builtWithLightingResolution != lightingResolution)
+		{
+			buildRenderGraph();
+			builtWithGBuffers = showGBuffers;
+			builtWithLayout = gBufferLayout;
+			builtWithPrepass = depthPrepass;
+			builtWithLightPath = pointLightPath;
+			builtWithRenderPath = renderPath;
+			builtWithSamples = msaaSamples;
+			builtWithTransparent = drawTransparent;
+			builtWithLightingResolution = lightingResolution;
+		}
+		if (pointLights.count != pointLightSpecs.count)
+		{
+			deletePointLights();
+			createPointLights(pointLightSpecs.count);
+			//Slots refer to light indices, which were all just reassigned
+			pointShadowAtlas.reset();
+		}
+		if (indexedOrbitRadius != pointLightSpecs.orbitRadius)
+		{
+			lightManager.setLights(lightRestPositions.data(), lightRadii.data(), pointLights.count, pointLightSpecs.orbitRadius);
+			indexedOrbitRadius = pointLightSpecs.orbitRadius;
+			//The monkeys spin in place, so this only changes with the index
+			lightNearDynamicCaster.assign(pointLights.count, false);
+			std::vector<uint32_t> nearby;
+			for (int node : scene.getMeshNodes(MESH_MONKEY))
+			{
+				sh::BoundingSphere sphere = sh::transformBounds(scene.getLocalBoundsMin(node), scene.getLocalBoundsMax(node), scene.getWorldMatrix(node));
+				lightManager.queryRadius(sphere.center, sphere.radius, nearby);
+				for (uint32_t light : nearby)
+					lightNearDynamicCaster[light] = true;
+			}
+		}
+		//Cull against this frame's camera and hand the survivors to the GPU
+		camera.aspectRatio = (float)screenWidth / screenHeight;
+		if (cullScene)
+		{
+			sceneBvh.cullFrustum(sh::extractFrustum(camera.projectionMatrix() * camera.viewMatrix()), cameraVisibleNodes);
+			//Node order keeps the draw order stable as things enter and leave the view
+			std::sort(cameraVisibleNodes.begin(), cameraVisibleNodes.end());
+			cameraCullStats = sceneBvh.getStats();
+		}
+		else
+		{
+			cameraVisibleNodes.clear();
+			for (int node = 0; node < scene.getNodeCount(); node++)
+			{
+				if (scene.getMesh(node) >= 0)
+					cameraVisibleNodes.push_back(node);
+			}
+			cameraCullStats = {};
+		}
+		if (pointLightSpecs.cpuCulling)
+		{
+			lightManager.cullFrustum(sh::extractFrustum(camera.projectionMatrix() * camera.viewMatrix()), visibleLights);
+		}
+		else
+		{
+			visibleLights.resize(pointLights.count);
+			for (int i = 0; i < pointLights.count; i++)
+				visibleLights[i] = (uint32_t)i;
+		}
+		pointLights.visibleCount = (int)visibleLights.size();
+		//Depth bounds batches want neighbours in depth, not on screen
+		if (renderPath == RenderPath::DEFERRED && pointLightPath == PointLightPath::VOLUMES && lightVolumeSpecs.depthTest && lightVolumeSpecs.depthBounds && glDepthBoundsEXT)
+		{
+			glm::vec3 forward = glm::normalize(camera.target - camera.position);
+			std::sort(visibleLights.begin(), visibleLights.end(), [&](uint32_t a, uint32_t b)
+			{
+				return glm::dot(lightRestPositions[a] - camera.position, forward) < glm::dot(lightRestPositions[b] - camera.position, forward);
+			});
+		}
+		if (pointLights.visibleCount > 0)
+			glNamedBufferSubData(pointLights.visibleBuffer, 0, sizeof(uint32_t) * visibleLights.size(), visibleLights.data());
+		//Visible lights compete for shadow slots by how much of the screen they can cover
+		shadowCandidates.clear();
+		if (pointShadowSpecs.enabled)
+		{
+			float projectionScale = 1.0f / tanf(glm::radians(camera.fov) * 0.5f);
+			bool lightsMove = pointLightSpecs.animate && pointLightSpecs.orbitRadius > 0.0f && pointLightSpecs.orbitSpeed > 0.0f;
+			for (uint32_t light : visibleLights)
+			{
+				float radius = lightRadii[light] + pointLightSpecs.orbitRadius;
+				float distance = glm::length(lightRestPositions[light] - camera.position);
+				//Half the screen height the sphere spans, capped once the camera is inside it
+				float priority = radius * projectionScale / glm::max(distance, radius);
+				shadowCandidates.push_back({ (int)light, priority, !lightsMove && !lightNearDynamicCaster[light] });
+			}
+		}
+		pointShadowAtlas.schedule(shadowCandidates, pointShadowSpecs.faceBudget, shadowUpdates);
+		for (const sh::ShadowSlotChange& change : pointShadowAtlas.getSlotChanges())
+		{
+			glNamedBufferSubData(pointLights.shadowSlotBuffer, sizeof(int) * change.light, sizeof(int), &change.slot);
+		}
+		//Reallocates screen sized targets if the window changed size since last frame
+		renderGraph.setSize(screenWidth, screenHeight);
+		sh::updateCascades(cascadedShadows, camera, lightSpecs.direction, shadowSpecs.distance, shadowSpecs.splitLambda, shadowSpecs.casterDistance);
+		renderGraph.execute();
+		gpuTimer.endFrame();
+		prevViewProjection = camera.projectionMatrix() * camera.viewMatrix();
+		lightingFrame++;
 
 		//Rotate model around Y axis
-		for (int i = 0; i < 8; i++)
+		for (int node : scene.getMeshNodes(MESH_MONKEY))
 		{
-			for (int j = 0; j < 8; j++)
-				monkeyTransform[i][j].rotation = glm::rotate(monkeyTransform[i][j].rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
+			scene.setRotation(node, glm::rotate(scene.getRotation(node), deltaTime, glm::vec3(0.0, 1.0, 0.0)));
 		}
 
-		lightCamera.position = lightSpecs.direction * shadowSpecs.camDistance;
-		lightCamera.orthoHeight = shadowSpecs.camSize;
 
 		cameraController.move(window, &camera, deltaTime);
 
@@ -342,8 +1580,18 @@ int main()
 		glfwSwapBuffers(window);
 	}
 	printf("Shutting down...");
-	sh::deleteFramebuffer(framebuffer);
-	sh::deleteShadowBuffer(shadowbuffer);
+	renderGraph.reset();
+	deleteCascadeViews();
+	sh::deleteCascadedShadowMap(cascadedShadows);
+	deletePointLights();
+	pointShadowAtlas.destroy();
+	if (lightTiles.buffer)
+	{
+		glDeleteBuffers(1, &lightTiles.buffer);
+		sh::releaseGpuAllocation(lightTiles.memoryId);
+	}
+	texturePacker.destroy();
+	gpuTimer.destroy();
 }
 
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
@@ -363,6 +1611,10 @@ void drawUI() {
 		if (ImGui::Button("Reset Camera")) {
 			resetCamera(&camera, &cameraController);
 		}
+		const char* tiers[3] = { "Low", "Medium", "High" };
+		int tier = (int)qualityTier;
+		if (ImGui::Combo("Quality", &tier, tiers, 3))
+			applyQualityTier((QualityTier)tier);
 		if (ImGui::CollapsingHeader("Material")) {
 			ImGui::SliderFloat("AmbientK", &material.Ka, 0.0f, 1.0f);
 			ImGui::SliderFloat("DiffuseK", &material.Kd, 0.0f, 1.0f);
@@ -376,9 +1628,111 @@ void drawUI() {
 			ImGui::ColorEdit3("Light Colour", (float*)&lightSpecs.colour);
 			ImGui::SliderFloat3("Direction", (float*)&lightSpecs.direction, -1.0f, 1.0f);
 		}
+		if (ImGui::CollapsingHeader("Scene")) {
+			const ew::SceneStats& stats = scene.getStats();
+			ImGui::Text("Nodes: %d", stats.nodeCount);
+			ImGui::Text("World matrices updated: %d", stats.updatedNodes);
+			ImGui::Checkbox("Frustum Culling", &cullScene);
+			ImGui::Text("BVH height: %d", sceneBvh.getHeight());
+			if (cullScene) {
+				const sh::BvhCullStats& cull = cameraCullStats;
+				ImGui::Text("Visible: %d / %d, culled: %d", cull.visibleCount, cull.proxyCount, cull.culledCount);
+				ImGui::Text("BVH nodes visited: %d", cull.nodesVisited);
+				ImGui::Text("Subtrees culled: %d, accepted: %d", cull.subtreesCulled, cull.subtreesAccepted);
+				ImGui::Text("Query: %.3f ms", cull.milliseconds);
+			}
+		}
+		if (ImGui::CollapsingHeader("Transform Benchmark")) {
+			TransformBenchmark& bench = transformBenchmark;
+			ImGui::SliderInt("Transforms", &bench.count, 1000, 1000000, "%d", ImGuiSliderFlags_Logarithmic);
+			ImGui::Checkbox("Normal Matrices", &bench.normals);
+			ImGui::Checkbox("World Bounds", &bench.bounds);
+			if (ImGui::Button("Run"))
+				runTransformBenchmark();
+			if (bench.hasRun) {
+				ImGui::Text("Scalar: %.3f ms", bench.scalarMs);
+				ImGui::Text("Batched: %.3f ms (%.1fx)", bench.batchMs, bench.scalarMs / glm::max(bench.batchMs, 0.0001f));
+				ImGui::Text("Batched, %d threads: %.3f ms (%.1fx)", threadPool.getThreadCount(), bench.parallelMs, bench.scalarMs / glm::max(bench.parallelMs, 0.0001f));
+				ImGui::Text("Max difference: %g", bench.maxError);
+			}
+		}
+		if (ImGui::CollapsingHeader("Point Lights")) {
+			//Only applied on release, every change reallocates the light buffers
+			static int requestedCount = pointLightSpecs.count;
+			ImGui::SliderInt("Count", &requestedCount, 1, 100000, "%d", ImGuiSliderFlags_Logarithmic);
+			if (ImGui::IsItemDeactivatedAfterEdit())
+				pointLightSpecs.count = requestedCount;
+			ImGui::Checkbox("Animate", &pointLightSpecs.animate);
+			ImGui::SliderFloat("Orbit Radius", &pointLightSpecs.orbitRadius, 0.0f, 4.0f);
+			ImGui::SliderFloat("Orbit Speed", &pointLightSpecs.orbitSpeed, 0.0f, 4.0f);
+			ImGui::Checkbox("CPU Frustum Culling", &pointLightSpecs.cpuCulling);
+			const sh::LightCullStats& stats = lightManager.getStats();
+			ImGui::Text("Visible: %d / %d", pointLights.visibleCount, pointLights.count);
+			if (pointLightSpecs.cpuCulling) {
+				ImGui::Text("Cells: %d (%d culled, %d inside)", stats.cellCount, stats.cellsCulled, stats.cellsAccepted);
+				ImGui::Text("Lights tested: %d in %.3f ms", stats.lightsTested, stats.milliseconds);
+			}
+		}
+		if (ImGui::CollapsingHeader("Point Light Shadows")) {
+			ImGui::Checkbox("Enabled", &pointShadowSpecs.enabled);
+			ImGui::SliderInt("Shadowed Lights", &pointShadowSpecs.slots, 1, 64);
+			const char* faceResolutions[4] = { "128", "256", "512", "1024" };
+			int faceResolutionIndex = pointShadowSpecs.resolution == 128 ? 0 : pointShadowSpecs.resolution == 256 ? 1 : pointShadowSpecs.resolution == 512 ? 2 : 3;
+			if (ImGui::Combo("Face Resolution", &faceResolutionIndex, faceResolutions, 4))
+				pointShadowSpecs.resolution = 128 << faceResolutionIndex;
+			ImGui::SliderInt("Faces Per Frame", &pointShadowSpecs.faceBudget, 1, 96);
+			ImGui::DragFloat("Bias", &pointShadowSpecs.bias, 0.001f, 0.0f, 0.2f);
+			if (ImGui::Button("Redraw All Faces"))
+				pointShadowAtlas.invalidate();
+			const sh::PointShadowStats& stats = pointShadowAtlas.getStats();
+			ImGui::Text("Resident: %d (%d ready), %d evicted", stats.residentLights, stats.readyLights, stats.evictions);
+			ImGui::Text("Faces drawn: %d, %d never drawn", stats.facesRendered, stats.facesMissing);
+		}
+		if (ImGui::CollapsingHeader("G-Buffer")) {
+			const char* layouts[2] = { "Standard (26 B/px)", "Compact (12 B/px)" };
+			int layout = (int)gBufferLayout;
+			if (ImGui::Combo("Layout", &layout, layouts, 2))
+				gBufferLayout = (sh::GBufferLayout)layout;
+		}
 		if (ImGui::CollapsingHeader("Shadow")) {
-			ImGui::DragFloat("Shadow Cam Distance", &shadowSpecs.camDistance, 0.05f, 5.0f, 100.0f);
-			ImGui::DragFloat("Shadow Cam Size", &shadowSpecs.camSize, 0.025f, 5.0f, 100.0f);
+			ImGui::DragFloat("Shadow Distance", &shadowSpecs.distance, 0.1f, 5.0f, 100.0f);
+			ImGui::SliderFloat("Split Lambda", &shadowSpecs.splitLambda, 0.0f, 1.0f);
+			ImGui::DragFloat("Caster Distance", &shadowSpecs.casterDistance, 0.1f, 0.0f, 100.0f);
+			ImGui::SliderInt("Cascades", &shadowSpecs.cascadeCount, 1, sh::MAX_CASCADES);
+			const char* resolutions[4] = { "256", "512", "1024", "2048" };
+			int resolutionIndex = shadowSpecs.resolution == 256 ? 0 : shadowSpecs.resolution == 512 ? 1 : shadowSpecs.resolution == 1024 ? 2 : 3;
+			if (ImGui::Combo("Cascade Resolution", &resolutionIndex, resolutions, 4))
+				shadowSpecs.resolution = 256 << resolutionIndex;
+			ImGui::Checkbox("Layered (one pass)", &shadowSpecs.layered);
+			const char* tapCounts[3] = { "4 taps", "8 taps", "16 taps" };
+			ImGui::Combo("PCF Taps", &shadowSpecs.pcfVariant, tapCounts, 3);
+			ImGui::SliderFloat("Filter Radius", &shadowSpecs.filterRadius, 0.5f, 4.0f);
+			for (int c = 0; c < cascadedShadows.cascadeCount; c++)
+			{
+				ImGui::Text("Cascade %d: to %.2f, %.3f units/texel", c, cascadedShadows.splitDistances[c], cascadedShadows.texelWorldSize[c]);
+			}
+			ImGui::Checkbox("Cull Casters", &shadowSpecs.cullCasters);
+			ImGui::SliderFloat("Min Caster Texels", &shadowSpecs.minCasterTexels, 0.0f, 8.0f);
+			if (ImGui::BeginTable("Caster Culling", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+				ImGui::TableSetupColumn("Cascade");
+				ImGui::TableSetupColumn("Drawn");
+				ImGui::TableSetupColumn("Outside");
+				ImGui::TableSetupColumn("Sub-texel");
+				ImGui::TableHeadersRow();
+				for (int c = 0; c < cascadedShadows.cascadeCount; c++)
+				{
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", c);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d / %d", shadowCullStats[c].drawn, shadowCullStats[c].tested);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", shadowCullStats[c].culledFrustum);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", shadowCullStats[c].culledSmall);
+				}
+				ImGui::EndTable();
+			}
 			ImGui::DragFloat("Shadow Min Bias", &shadowSpecs.minBias, 0.000025f, 0.001f, 0.05f);
 			ImGui::DragFloat("Shadow Max Bias", &shadowSpecs.maxBias, 0.000025f, 0.015f, 0.1f);
 		}
@@ -389,17 +1743,89 @@ void drawUI() {
 	//GBUFFER PANELS
 	{
 		ImGui::Begin("GBuffers");
-		ImVec2 windowSize = ImGui::GetWindowSize();
-		ImVec2 texSize = ImVec2(gBuffer.width / 4, gBuffer.height / 4);
-		for (size_t i = 0; i < 3; i++)
+		ImGui::Checkbox("Show GBuffers", &showGBuffers);
+		if (showGBuffers && renderPath == RenderPath::DEFERRED)
+		{
+			ImVec2 texSize = ImVec2(screenWidth / 4, screenHeight / 4);
+			for (size_t i = 0; i < 3; i++)
+			{
+				ImGui::Image((ImTextureID)(size_t)renderGraph.getTexture(graphTargets.gBuffer[i]), texSize, ImVec2(0, 1), ImVec2(1, 0));
+			}
+			//add in shadow cascades
+			ImVec2 cascadeSize = ImVec2(screenHeight / 4, screenHeight / 4);
+			for (int c = 0; c < cascadedShadows.cascadeCount; c++)
+			{
+				if (c > 0)
+					ImGui::SameLine();
+				ImGui::Image((ImTextureID)(size_t)cascadeViews[c], cascadeSize, ImVec2(0, 1), ImVec2(1, 0));
+			}
+		}
+		ImGui::End();
+	}
+
+	//RENDER GRAPH
+	{
+		ImGui::Begin("Render Graph");
+		ImGui::Text("%d resources in %d pooled textures", renderGraph.getResourceCount(), renderGraph.getPhysicalTextureCount());
+		for (int i = 0; i < renderGraph.getPassCount(); i++)
+		{
+			ImGui::Text("%s %s", renderGraph.isPassLive(i) ? "[live]  " : "[culled]", renderGraph.getPassName(i).c_str());
+		}
+		const char* renderPaths[2] = { "Deferred", "Forward+" };
+		int path = (int)renderPath;
+		if (ImGui::Combo("Render Path", &path, renderPaths, 2))
+			renderPath = (RenderPath)path;
+		if (renderPath == RenderPath::DEFERRED)
+		{
+			ImGui::Checkbox("Depth Prepass", &depthPrepass);
+			const char* lightPaths[3] = { "Light Volumes", "Tiled Compute", "Stochastic" };
+			int lightPath = (int)pointLightPath;
+			if (ImGui::Combo("Point Lights", &lightPath, lightPaths, 3))
+				pointLightPath = (PointLightPath)lightPath;
+			if (pointLightPath == PointLightPath::STOCHASTIC)
+			{
+				ImGui::SliderInt("Candidates", &stochasticSpecs.candidates, 1, 32);
+				ImGui::Checkbox("Temporal Reuse", &stochasticSpecs.temporal);
+				ImGui::SliderInt("Max History", &stochasticSpecs.maxHistory, 1, 64);
+			}
+			else
+			{
+				if (pointLightPath == PointLightPath::VOLUMES)
+				{
+					ImGui::Checkbox("Volume Depth Test", &lightVolumeSpecs.depthTest);
+					if (glDepthBoundsEXT)
+					{
+						ImGui::Checkbox("Depth Bounds", &lightVolumeSpecs.depthBounds);
+						ImGui::SliderInt("Lights Per Batch", &lightVolumeSpecs.batchSize, 1, 256, "%d", ImGuiSliderFlags_Logarithmic);
+					}
+					else
+					{
+						ImGui::Text("Depth bounds test not supported");
+					}
+					ImGui::Text("Volume draws: %d", lightVolumeBatches);
+				}
+				const char* resolutions[3] = { "Full", "Half", "Quarter" };
+				int resolution = (int)lightingResolution;
+				if (ImGui::Combo("Point Light Resolution", &resolution, resolutions, 3))
+					lightingResolution = (LightingResolution)resolution;
+			}
+		}
+		else
 		{
-			ImGui::Image((ImTextureID)gBuffer.colorBuffer[i], texSize, ImVec2(0, 1), ImVec2(1, 0));
+			const char* sampleCounts[4] = { "Off", "2x", "4x", "8x" };
+			int sampleIndex = msaaSamples == 8 ? 3 : msaaSamples == 4 ? 2 : msaaSamples == 2 ? 1 : 0;
+			if (ImGui::Combo("MSAA", &sampleIndex, sampleCounts, 4))
+				msaaSamples = sampleIndex == 0 ? 1 : 1 << sampleIndex;
+			ImGui::Checkbox("Transparent Spheres", &drawTransparent);
+			ImGui::SliderFloat("Sphere Alpha", &transparentAlpha, 0.0f, 1.0f);
 		}
-		//add in shadow map
-		ImGui::Image((ImTextureID)shadowbuffer.shadowMap, texSize, ImVec2(0, 1), ImVec2(1, 0));
+		if (renderPath == RenderPath::FORWARD_PLUS || (renderPath == RenderPath::DEFERRED && pointLightPath == PointLightPath::TILED_COMPUTE))
+			ImGui::Checkbox("Tile Heatmap", &showTileHeatmap);
+		gpuTimer.drawTable();
 		ImGui::End();
 	}
 
+	sh::drawGpuMemoryWindow();
 
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -407,9 +1833,12 @@ void drawUI() {
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	//Minimized windows report 0x0, keep the last real size
+	if (width == 0 || height == 0)
+		return;
 	screenWidth = width;
 	screenHeight = height;
+	renderGraph.setSize(screenWidth, screenHeight);
 }
 
 /// <summary>
@@ -437,6 +1866,8 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		printf("GLAD Failed to load GL headers");
 		return nullptr;
 	}
+	if (glfwExtensionSupported("GL_EXT_depth_bounds_test"))
+		glDepthBoundsEXT = (PFNGLDEPTHBOUNDSEXTPROC)glfwGetProcAddress("glDepthBoundsEXT");
 
 	//Initialize ImGUI
 	IMGUI_CHECKVERSION();
@@ -29,9 +29,45 @@ struct Shadow{
 	float camSize;
 	float minBias;
 	float maxBias;
+	float minVariance; //VSM/EVSM: floor on variance, hides precision acne
+	float lightBleed; //VSM/EVSM: fraction of the lit tail cut off to hide light bleeding
 };
 uniform Shadow _Shadow;
+uniform vec2 _EvsmExponents = vec2(5.0);
 
+#if defined(VSM) || defined(EVSM)
+//One sided Chebyshev upper bound on the fraction of the filter region at or beyond depth
+float chebyshev(vec2 moments, float depth, float minVariance)
+{
+	if (depth <= moments.x)
+		return 1.0;
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float d = depth - moments.x;
+	float pMax = variance / (variance + d * d);
+	//Light bleed reduction: anything below lightBleed counts as fully shadowed
+	return clamp((pMax - _Shadow.lightBleed) / (1.0 - _Shadow.lightBleed), 0.0, 1.0);
+}
+
+//The moments were blurred and mipmapped once this frame, so one trilinear fetch is the whole filter
+float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, float bias)
+{
+	vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
+	sampleCoord = sampleCoord * 0.5 + 0.5;
+	vec4 moments = texture(shadowMap, sampleCoord.xy);
+	float depth = sampleCoord.z - bias;
+#ifdef EVSM
+	depth = depth * 2.0 - 1.0;
+	float positive = exp(_EvsmExponents.x * depth);
+	float negative = -exp(-_EvsmExponents.y * depth);
+	//Variance scales with the derivative of the warp, so minVariance is scaled to match
+	float positiveLit = chebyshev(moments.xy, positive, _Shadow.minVariance * _EvsmExponents.x * _EvsmExponents.x * positive * positive);
+	float negativeLit = chebyshev(moments.zw, negative, _Shadow.minVariance * _EvsmExponents.y * _EvsmExponents.y * negative * negative);
+	return 1.0 - min(positiveLit, negativeLit);
+#else
+	return 1.0 - chebyshev(moments.xy, depth, _Shadow.minVariance);
+#endif
+}
+#else
 float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, float bias)
 {
 	//Homogeneous Clip space to NDC [-w,w] to [-1,1]
@@ -54,6 +90,7 @@ float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, float bias)
 
 	return totalShadow;
 }
+#endif
 
 void main()
 {
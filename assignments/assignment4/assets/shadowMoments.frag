@@ -0,0 +1,25 @@
+//shadowMoments.frag
+#version 450
+//Writes filterable depth moments for VSM, or exponentially warped moments with EVSM defined.
+//Pair with depthOnly.vert.
+out vec4 FragMoments;
+
+uniform vec2 _EvsmExponents = vec2(5.0);
+
+void main()
+{
+	//Orthographic light, so window depth is already linear
+	float depth = gl_FragCoord.z;
+#ifdef EVSM
+	//Warp to [-1,1] first so both exponents have the same range to work with
+	depth = depth * 2.0 - 1.0;
+	float positive = exp(_EvsmExponents.x * depth);
+	float negative = -exp(-_EvsmExponents.y * depth);
+	FragMoments = vec4(positive, positive * positive, negative, negative * negative);
+#else
+	//Slope term keeps steep surfaces from self shadowing after filtering
+	float dx = dFdx(depth);
+	float dy = dFdy(depth);
+	FragMoments = vec4(depth, depth * depth + 0.25 * (dx * dx + dy * dy), 0.0, 0.0);
+#endif
+}
@@ -1,6 +1,10 @@
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
 
 #include <ew/external/glad.h>
 #include <ew/shader.h>
@@ -10,8 +14,14 @@
 #include <ew/cameraController.h>
 #include <ew/texture.h>
 #include <ew/procGen.h>
+#include <ew/scene.h>
+#include <ew/threadPool.h>
+#include <ew/transformBatch.h>
+#include <ew/hierarchySolver.h>
 #include <sh/framebuffer.h>
 #include <sh/shadowbuffer.h>
+#include <sh/gpuMemory.h>
+#include <sh/shadowFit.h>
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -28,8 +38,15 @@ unsigned int screenHeight = 720;
 float prevFrameTime;
 float deltaTime;
 
-ew::Transform planeTransform;
-ew::Transform monkeyTransforms[8];
+//The monkey hierarchy and the plane. Parents are created before children, so solving FK is one
+//forward walk over the nodes, done once per frame by updateWorldTransforms().
+ew::Scene scene;
+//Mesh ids for ew::Scene
+enum SceneMesh
+{
+	MESH_MONKEY = 0,
+	MESH_PLANE = 1
+};
 ew::CameraController cameraController;
 ew::Camera camera, lightCamera;
 
@@ -57,29 +74,129 @@ struct Shadow {
 	float camSize = 10.0f;
 	float minBias = 0.005f;
 	float maxBias = 0.015f;
+	int filter = 0; //Index into shadowFilterModes
+	int blurRadius = 4; //Texels, VSM/EVSM only
+	float minVariance = 0.00002f;
+	float lightBleed = 0.2f;
+	bool autoFit = true; //Fit the light frustum to the visible scene instead of camDistance/camSize
+	float distance = 30.0f; //How far from the camera shadows are drawn when auto fitting
 }shadowSpecs;
 
-struct Node
+sh::ShadowFit shadowFit;
+
+
+//PCF samples the depth directly, the others sample prefiltered moments
+const sh::ShadowMode shadowFilterModes[3] = { sh::ShadowMode::DEPTH, sh::ShadowMode::VSM, sh::ShadowMode::EVSM };
+const char* shadowFilterNames[3] = { "PCF 3x3", "VSM", "EVSM" };
+
+ew::ThreadPool threadPool;
+
+//Times ew::HierarchySolver against a serial parent first walk over a generated hierarchy
+struct FKBenchmarkResult
 {
-	glm::mat4 localTransform;
-	glm::mat4 globalTransform;
-	unsigned int parentIndex;
+	int nodeCount;
+	int levels;
+	float serialMs; //One node after another, parents first
+	float solverMs; //Level by level on the calling thread
+	float parallelMs; //Level by level across threadPool
+	float incrementalMs; //Only the changed nodes and their descendants, across threadPool
+	int incrementalNodes;
+	float maxError; //Largest world matrix difference from the serial walk
 };
 
-struct Hierarchy
+struct FKBenchmark
 {
-	Node* nodes;
-	unsigned int nodeCount;
-}parentHierarchy;
+	int nodeCount = 100000;
+	int branching = 4; //Children per node, 1 makes a single chain
+	float changedFraction = 0.01f; //Of the nodes, marked for the incremental solve
+	std::vector<FKBenchmarkResult> results;
+}fkBenchmark;
 
-void SolveFK(Hierarchy hierarchy)
+FKBenchmarkResult runFKBenchmark(int nodeCount)
 {
-	for (int i = 0; i < static_cast<int>(hierarchy.nodeCount); i++)
+	FKBenchmarkResult result = {};
+	result.nodeCount = nodeCount;
+	int branching = glm::max(fkBenchmark.branching, 1);
+	std::vector<int> parents(nodeCount);
+	std::vector<glm::vec3> positions(nodeCount), scales(nodeCount);
+	std::vector<glm::quat> rotations(nodeCount);
+	for (int i = 0; i < nodeCount; i++)
 	{
-		if (hierarchy.nodes[i].parentIndex == -1)
-			hierarchy.nodes[i].globalTransform = hierarchy.nodes[i].localTransform;
-		else
-			hierarchy.nodes[i].globalTransform = hierarchy.nodes[hierarchy.nodes[i].parentIndex].globalTransform * hierarchy.nodes[i].localTransform;
+		parents[i] = i == 0 ? -1 : (i - 1) / branching;
+		positions[i] = glm::vec3(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100) * 0.01f;
+		rotations[i] = glm::angleAxis((rand() % 628) * 0.01f, glm::normalize(glm::vec3(rand() % 100 + 1, rand() % 100, rand() % 100)));
+		scales[i] = glm::vec3(0.99f);
+	}
+	std::vector<glm::mat4> local(nodeCount), serialWorld(nodeCount), world(nodeCount);
+	ew::TransformBatchInput input;
+	input.positions = positions.data();
+	input.rotations = rotations.data();
+	input.scales = scales.data();
+	input.count = nodeCount;
+	ew::TransformBatchOutput output;
+	output.models = local.data();
+	ew::buildTransforms(input, output, &threadPool);
+
+	ew::HierarchySolver solver;
+	solver.build(parents.data(), nodeCount);
+	result.levels = solver.getLevelCount();
+
+	//Best of a few runs, the first touches memory that later runs find in cache.
+	//prepare runs before each timed run and isn't counted.
+	auto bestTime = [&](auto&& prepare, auto&& run)
+	{
+		float best = FLT_MAX;
+		for (int r = 0; r < 3; r++)
+		{
+			prepare();
+			auto start = std::chrono::high_resolution_clock::now();
+			run();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = glm::min(best, std::chrono::duration<float, std::milli>(end - start).count());
+		}
+		return best;
+	};
+	auto nothing = [] {};
+	result.serialMs = bestTime(nothing, [&]
+	{
+		for (int i = 0; i < nodeCount; i++)
+			serialWorld[i] = parents[i] < 0 ? local[i] : serialWorld[parents[i]] * local[i];
+	});
+	result.solverMs = bestTime(nothing, [&] { solver.solve(local.data(), world.data()); });
+	result.parallelMs = bestTime(nothing, [&] { solver.solve(local.data(), world.data(), &threadPool); });
+	int changedCount = glm::max((int)(nodeCount * fkBenchmark.changedFraction), 1);
+	//rand() stops at 32767 on some platforms, which would only ever mark nodes near the root
+	std::mt19937 random;
+	std::uniform_int_distribution<int> anyNode(0, nodeCount - 1);
+	result.incrementalMs = bestTime([&]
+	{
+		for (int i = 0; i < changedCount; i++)
+			solver.markChanged(anyNode(random));
+	}, [&] { solver.solveChanged(local.data(), world.data(), &threadPool); });
+	result.incrementalNodes = solver.getStats().solvedNodes;
+
+	for (int i = 0; i < nodeCount; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			glm::vec4 difference = glm::abs(serialWorld[i][c] - world[i][c]);
+			result.maxError = glm::max(result.maxError, glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)));
+		}
+	}
+	return result;
+}
+
+//World space bounds of everything that casts or receives shadows
+void sceneBounds(glm::vec3& outMin, glm::vec3& outMax)
+{
+	outMin = glm::vec3(FLT_MAX);
+	outMax = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < scene.getNodeCount(); i++)
+	{
+		if (scene.getMesh(i) < 0)
+			continue;
+		outMin = glm::min(outMin, scene.getWorldBoundsMin(i));
+		outMax = glm::max(outMax, scene.getWorldBoundsMax(i));
 	}
 }
 
@@ -87,20 +204,33 @@ void SolveFK(Hierarchy hierarchy)
 int main() {
 	GLFWwindow* window = initWindow("Assignment 2", screenWidth, screenHeight);
 
-	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
+	//One variant per entry in shadowFilterModes
+	ew::Shader litShaders[3] = {
+		ew::Shader("assets/lit.vert", "assets/lit.frag"),
+		ew::Shader("assets/lit.vert", "assets/lit.frag", { "VSM" }),
+		ew::Shader("assets/lit.vert", "assets/lit.frag", { "EVSM" })
+	};
+	ew::Shader shadowShaders[3] = {
+		ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag"),
+		ew::Shader("assets/depthOnly.vert", "assets/shadowMoments.frag"),
+		ew::Shader("assets/depthOnly.vert", "assets/shadowMoments.frag", { "EVSM" })
+	};
+	ew::Shader momentBlurShaders[3] = {
+		ew::Shader::createCompute("assets/momentBlur.comp"),
+		ew::Shader::createCompute("assets/momentBlur.comp"),
+		ew::Shader::createCompute("assets/momentBlur.comp", { "EVSM" })
+	};
 	ew::Shader postProcessingShader = ew::Shader("assets/screenQuad.vert", "assets/postProcess.frag");
-	ew::Shader shadowShader = ew::Shader("assets/depthOnly.vert", "assets/depthOnly.frag");
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
 	ew::Mesh planeMesh = ew::Mesh(ew::createPlane(10, 10, 5));
-	\
-	planeTransform.position = glm::vec3(0.0f, -2.0f, 0.0f);
 
 	//Handles to OpenGL object are unsigned integers
 	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
 	glEnable(GL_CULL_FACE);
 
 	//create buffers
-	shadowbuffer = sh::createShadowBuffer(2048, 2048);
+	int builtShadowFilter = shadowSpecs.filter;
+	shadowbuffer = sh::createShadowBuffer(2048, 2048, shadowFilterModes[builtShadowFilter]);
 	framebuffer = sh::createFramebuffer(screenWidth, screenHeight, (int)(GL_RGB16F));
 
 	unsigned int dummyVAO;
@@ -125,41 +255,26 @@ int main() {
 
 	//set up hierarchy
 	{
-		//set number of nodes
-		parentHierarchy.nodeCount = 8;
-		parentHierarchy.nodes = new Node[parentHierarchy.nodeCount];
-
-		//set the positions of each monkey
-		monkeyTransforms[0].position = glm::vec3(0.0);
-		monkeyTransforms[1].position = glm::vec3(-2.0, 0.0, 0.0);
-		monkeyTransforms[2].position = glm::vec3(2.0, 0.0, 0.0);
-		monkeyTransforms[3].position = glm::vec3(0.0, 2.0, 0.0);
-		monkeyTransforms[4].position = glm::vec3(-2.0, 0.0, 0.0);
-		monkeyTransforms[5].position = glm::vec3(2.0, 0.0, 0.0);
-		monkeyTransforms[6].position = glm::vec3(0.0, 2.0, 0.0);
-		monkeyTransforms[7].position = glm::vec3(0.0, 2.0, 0.0);
-
-		//set the scales of each monkey that isn't 1
-		for (int i = 1; i < static_cast<int>(parentHierarchy.nodeCount); i++)
-		{
-			monkeyTransforms[i].scale = glm::vec3(0.75);
-		}
-
-		//set the transforms of each node in the hierarchy
-		for (int i = 0; i < static_cast<int>(parentHierarchy.nodeCount); i++)
+		//set the positions and parents of each monkey, parents come first
+		const glm::vec3 positions[8] = {
+			glm::vec3(0.0), glm::vec3(-2.0, 0.0, 0.0), glm::vec3(2.0, 0.0, 0.0), glm::vec3(0.0, 2.0, 0.0),
+			glm::vec3(-2.0, 0.0, 0.0), glm::vec3(2.0, 0.0, 0.0), glm::vec3(0.0, 2.0, 0.0), glm::vec3(0.0, 2.0, 0.0)
+		};
+		const int parents[8] = { -1, 0, 0, 0, 1, 2, 4, 5 };
+		for (int i = 0; i < 8; i++)
 		{
-			parentHierarchy.nodes[i].localTransform = monkeyTransforms[i].modelMatrix();
+			ew::Transform transform;
+			transform.position = positions[i];
+			//every monkey but the root is scaled down
+			if (i > 0)
+				transform.scale = glm::vec3(0.75);
+			int node = scene.createNode(transform, parents[i]);
+			scene.setMesh(node, MESH_MONKEY, monkeyModel.getBoundsMin(), monkeyModel.getBoundsMax());
 		}
 
-		//set the parents of each node
-		parentHierarchy.nodes[0].parentIndex = -1;
-		parentHierarchy.nodes[1].parentIndex = 0;
-		parentHierarchy.nodes[2].parentIndex = 0;
-		parentHierarchy.nodes[3].parentIndex = 0;
-		parentHierarchy.nodes[4].parentIndex = 1;
-		parentHierarchy.nodes[5].parentIndex = 2;
-		parentHierarchy.nodes[6].parentIndex = 4;
-		parentHierarchy.nodes[7].parentIndex = 5;
+		ew::Transform planeTransform;
+		planeTransform.position = glm::vec3(0.0f, -2.0f, 0.0f);
+		scene.setMesh(scene.createNode(planeTransform), MESH_PLANE, planeMesh.getBoundsMin(), planeMesh.getBoundsMax());
 	}
 
 	while (!glfwWindowShouldClose(window)) 
@@ -170,36 +285,56 @@ int main() {
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
-		//set the transforms of each node in the hierarchy
-		for (int i = 0; i < static_cast<int>(parentHierarchy.nodeCount); i++)
+		//solve for global monkey transforms. The root rotates every frame, so the whole hierarchy is recomputed.
+		scene.updateWorldTransforms();
+
+		//Moment modes need a color target, so switching filters means a new buffer
+		if (builtShadowFilter != shadowSpecs.filter)
+		{
+			sh::deleteShadowBuffer(shadowbuffer);
+			builtShadowFilter = shadowSpecs.filter;
+			shadowbuffer = sh::createShadowBuffer(2048, 2048, shadowFilterModes[builtShadowFilter]);
+		}
+		ew::Shader& shader = litShaders[builtShadowFilter];
+
+		glm::mat4 lightViewProj = lightCamera.projectionMatrix() * lightCamera.viewMatrix();
+		if (shadowSpecs.autoFit)
 		{
-			parentHierarchy.nodes[i].localTransform = monkeyTransforms[i].modelMatrix();
+			glm::vec3 boundsMin, boundsMax;
+			sceneBounds(boundsMin, boundsMax);
+			shadowFit = sh::fitLightFrustum(camera, lightSpecs.direction, boundsMin, boundsMax, shadowSpecs.distance, shadowbuffer.width);
+			lightViewProj = shadowFit.viewProj;
 		}
-		//solve for global monkey transforms
-		SolveFK(parentHierarchy);
+		ew::Shader& shadowShader = shadowShaders[builtShadowFilter];
 
 		//RENDER TO SHADOW BUFFER
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, shadowbuffer.fbo);
-			glViewport(0, 0, shadowbuffer.width, shadowbuffer.height);
-			glClear(GL_DEPTH_BUFFER_BIT);
+			sh::beginShadowPass(shadowbuffer);
+			glEnable(GL_DEPTH_TEST);
 			glCullFace(GL_FRONT);
 
 			shadowShader.use();
+			shadowShader.setVec2("_EvsmExponents", glm::vec2(sh::EVSM_POSITIVE_EXPONENT, sh::EVSM_NEGATIVE_EXPONENT));
 
-			shadowShader.setMat4("_ViewProjection", lightCamera.projectionMatrix() * lightCamera.viewMatrix());
+			shadowShader.setMat4("_ViewProjection", lightViewProj);
 
 			//draw all monkeys
 			{
-				for (int i = 0; i < static_cast<int>(parentHierarchy.nodeCount); i++)
+				for (int node : scene.getMeshNodes(MESH_MONKEY))
 				{
-					shadowShader.setMat4("_Model", parentHierarchy.nodes[i].globalTransform);
+					shadowShader.setMat4("_Model", scene.getWorldMatrix(node));
 					monkeyModel.draw();
 				}
 			}
 
-			shadowShader.setMat4("_Model", planeTransform.modelMatrix());
-			planeMesh.draw();
+			for (int node : scene.getMeshNodes(MESH_PLANE))
+			{
+				shadowShader.setMat4("_Model", scene.getWorldMatrix(node));
+				planeMesh.draw();
+			}
+
+			//Blur once in shadow map space so lighting is a single fetch no matter the screen size
+			sh::prefilterShadowMoments(shadowbuffer, momentBlurShaders[builtShadowFilter], shadowSpecs.blurRadius);
 		}
 		//RENDER TO FRAMEBUFFER WITH SHADOW MAP
 		{
@@ -214,7 +349,7 @@ int main() {
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, brickTexture);
 			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, shadowbuffer.shadowMap);
+			glBindTexture(GL_TEXTURE_2D, sh::getShadowSampleTexture(shadowbuffer));
 
 			glActiveTexture(GL_TEXTURE0);
 			glDrawBuffer(GL_COLOR_ATTACHMENT0);
@@ -236,22 +371,27 @@ int main() {
 			shader.setFloat("_Material.Shininess", material.Shininess);
 			shader.setFloat("_Shadow.minBias", shadowSpecs.minBias);
 			shader.setFloat("_Shadow.maxBias", shadowSpecs.maxBias);
+			shader.setFloat("_Shadow.minVariance", shadowSpecs.minVariance);
+			shader.setFloat("_Shadow.lightBleed", shadowSpecs.lightBleed);
+			shader.setVec2("_EvsmExponents", glm::vec2(sh::EVSM_POSITIVE_EXPONENT, sh::EVSM_NEGATIVE_EXPONENT));
 
 			shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-			shader.setMat4("_LightViewProj", lightCamera.projectionMatrix() * lightCamera.viewMatrix());
+			shader.setMat4("_LightViewProj", lightViewProj);
 
 			//draw all monkeys
 			{
-				for (int i = 0; i < static_cast<int>(parentHierarchy.nodeCount); i++)
+				for (int node : scene.getMeshNodes(MESH_MONKEY))
 				{
-					shader.setMat4("_Model", parentHierarchy.nodes[i].globalTransform);
+					shader.setMat4("_Model", scene.getWorldMatrix(node));
 					monkeyModel.draw();
 				}
 			}
 
-
-			shader.setMat4("_Model", planeTransform.modelMatrix());
-			planeMesh.draw();
+			for (int node : scene.getMeshNodes(MESH_PLANE))
+			{
+				shader.setMat4("_Model", scene.getWorldMatrix(node));
+				planeMesh.draw();
+			}
 
 			glBindTextureUnit(0, framebuffer.colorBuffer[0]);
 		}
@@ -271,12 +411,16 @@ int main() {
 
 		//rotate monkeys
 		{
-			monkeyTransforms[0].rotation = glm::rotate(monkeyTransforms[0].rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
-			monkeyTransforms[1].rotation = glm::rotate(monkeyTransforms[1].rotation, deltaTime, glm::vec3(1.0, 0.0, 0.0));
-			monkeyTransforms[2].rotation = glm::rotate(monkeyTransforms[2].rotation, deltaTime, glm::vec3(-1.0, 0.0, -0.0));
-			monkeyTransforms[3].rotation = glm::rotate(monkeyTransforms[3].rotation, deltaTime, glm::vec3(0.0, -1.0, 0.0));
-			monkeyTransforms[6].rotation = glm::rotate(monkeyTransforms[6].rotation, deltaTime, glm::vec3(0.0, 0.0, 1.0));
-			monkeyTransforms[7].rotation = glm::rotate(monkeyTransforms[7].rotation, deltaTime, glm::vec3(0.0, 0.0, -1.0));
+			const int spinning[6] = { 0, 1, 2, 3, 6, 7 };
+			const glm::vec3 axes[6] = {
+				glm::vec3(0.0, 1.0, 0.0), glm::vec3(1.0, 0.0, 0.0), glm::vec3(-1.0, 0.0, -0.0),
+				glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, 0.0, -1.0)
+			};
+			for (int i = 0; i < 6; i++)
+			{
+				int node = spinning[i];
+				scene.setRotation(node, glm::rotate(scene.getRotation(node), deltaTime, axes[i]));
+			}
 		}
 
 		lightCamera.position = lightSpecs.direction * shadowSpecs.camDistance;
@@ -322,10 +466,64 @@ void drawUI() {
 		ImGui::SliderFloat3("Direction", (float*)&lightSpecs.direction, -1.0f, 1.0f);
 	}
 	if (ImGui::CollapsingHeader("Shadow")) {
-		ImGui::DragFloat("Shadow Cam Distance", &shadowSpecs.camDistance, 0.05f, 5.0f, 50);
-		ImGui::DragFloat("Shadow Cam Size", &shadowSpecs.camSize, 0.025f, 5.0f, 20.0f);
+		ImGui::Checkbox("Auto Fit", &shadowSpecs.autoFit);
+		if (shadowSpecs.autoFit) {
+			ImGui::DragFloat("Shadow Distance", &shadowSpecs.distance, 0.1f, 1.0f, 100.0f);
+			ImGui::Text("Texel: %.4f x %.4f", shadowFit.texelWorldSize.x, shadowFit.texelWorldSize.y);
+			ImGui::Text("Depth Range: %.2f", shadowFit.farPlane - shadowFit.nearPlane);
+			if (!shadowFit.valid)
+				ImGui::TextUnformatted("Camera sees none of the scene");
+		}
+		else {
+			ImGui::DragFloat("Shadow Cam Distance", &shadowSpecs.camDistance, 0.05f, 5.0f, 50);
+			ImGui::DragFloat("Shadow Cam Size", &shadowSpecs.camSize, 0.025f, 5.0f, 20.0f);
+		}
 		ImGui::DragFloat("Shadow Min Bias", &shadowSpecs.minBias, 0.000025f, 0.001f, 0.05f);
 		ImGui::DragFloat("Shadow Max Bias", &shadowSpecs.maxBias, 0.000025f, 0.015f, 0.1f);
+		ImGui::Combo("Filtering", &shadowSpecs.filter, shadowFilterNames, 3);
+		if (sh::isMomentShadowMode(shadowFilterModes[shadowSpecs.filter])) {
+			ImGui::SliderInt("Blur Radius", &shadowSpecs.blurRadius, 0, 16);
+			ImGui::DragFloat("Min Variance", &shadowSpecs.minVariance, 0.000001f, 0.0f, 0.001f, "%.6f");
+			ImGui::SliderFloat("Light Bleed Reduction", &shadowSpecs.lightBleed, 0.0f, 0.9f);
+		}
+	}
+	if (ImGui::CollapsingHeader("FK Benchmark")) {
+		ImGui::SliderInt("Nodes", &fkBenchmark.nodeCount, 8, 1 << 20, "%d", ImGuiSliderFlags_Logarithmic);
+		ImGui::SliderInt("Branching", &fkBenchmark.branching, 1, 16);
+		ImGui::SliderFloat("Changed Fraction", &fkBenchmark.changedFraction, 0.0001f, 1.0f, "%.4f", ImGuiSliderFlags_Logarithmic);
+		if (ImGui::Button("Run")) {
+			fkBenchmark.results.clear();
+			fkBenchmark.results.push_back(runFKBenchmark(fkBenchmark.nodeCount));
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Sweep 8 to 1M")) {
+			fkBenchmark.results.clear();
+			for (int count = 8; count <= 1 << 20; count *= 8)
+				fkBenchmark.results.push_back(runFKBenchmark(count));
+			fkBenchmark.results.push_back(runFKBenchmark(1 << 20));
+		}
+		ImGui::Text("%d threads", threadPool.getThreadCount());
+		if (!fkBenchmark.results.empty() && ImGui::BeginTable("FK Results", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("Nodes");
+			ImGui::TableSetupColumn("Levels");
+			ImGui::TableSetupColumn("Serial ms");
+			ImGui::TableSetupColumn("Levels ms");
+			ImGui::TableSetupColumn("Parallel ms");
+			ImGui::TableSetupColumn("Incremental ms (nodes)");
+			ImGui::TableSetupColumn("Max Diff");
+			ImGui::TableHeadersRow();
+			for (const FKBenchmarkResult& result : fkBenchmark.results) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%d", result.nodeCount);
+				ImGui::TableNextColumn(); ImGui::Text("%d", result.levels);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", result.serialMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", result.solverMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", result.parallelMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f (%d)", result.incrementalMs, result.incrementalNodes);
+				ImGui::TableNextColumn(); ImGui::Text("%g", result.maxError);
+			}
+			ImGui::EndTable();
+		}
 	}
 	//Add more camera settings here!
 
@@ -342,6 +540,8 @@ void drawUI() {
 	ImGui::EndChild();
 	ImGui::End();
 
+	sh::drawGpuMemoryWindow();
+
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -0,0 +1,179 @@
+#include "gpuMemory.h"
+#include <map>
+#include <algorithm>
+
+namespace ew {
+	struct Allocation {
+		GpuMemoryCategory category;
+		std::string name;
+		size_t bytes;
+		size_t peakBytes;
+	};
+
+	static std::map<int, Allocation> allocations;
+	static int nextAllocationId = 0;
+	static size_t categoryBytes[(int)GpuMemoryCategory::COUNT] = {};
+	static size_t categoryPeakBytes[(int)GpuMemoryCategory::COUNT] = {};
+	static size_t totalBytes = 0;
+	static size_t totalPeakBytes = 0;
+
+	static void updatePeaks(GpuMemoryCategory category) {
+		int c = (int)category;
+		categoryPeakBytes[c] = std::max(categoryPeakBytes[c], categoryBytes[c]);
+		totalPeakBytes = std::max(totalPeakBytes, totalBytes);
+	}
+
+	const char* getGpuMemoryCategoryName(GpuMemoryCategory category) {
+		switch (category) {
+		case GpuMemoryCategory::TEXTURE:
+			return "Textures";
+		case GpuMemoryCategory::RENDER_TARGET:
+			return "Render Targets";
+		case GpuMemoryCategory::SHADOW_MAP:
+			return "Shadow Maps";
+		case GpuMemoryCategory::VERTEX_BUFFER:
+			return "Vertex Buffers";
+		case GpuMemoryCategory::INDEX_BUFFER:
+			return "Index Buffers";
+		case GpuMemoryCategory::UNIFORM_BUFFER:
+			return "Uniform Buffers";
+		case GpuMemoryCategory::STORAGE_BUFFER:
+			return "Storage Buffers";
+		default:
+			return "Unknown";
+		}
+	}
+
+	size_t bytesPerPixel(int internalFormat) {
+		switch (internalFormat) {
+		case GL_R8:
+		case GL_R8_SNORM:
+		case GL_R8UI:
+		case GL_STENCIL_INDEX8:
+			return 1;
+		case GL_RG8:
+		case GL_RG8_SNORM:
+		case GL_R16:
+		case GL_R16F:
+		case GL_R16UI:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGB8:
+		case GL_SRGB8:
+		case GL_DEPTH_COMPONENT24:
+			return 3;
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+		case GL_RGB10_A2:
+		case GL_R11F_G11F_B10F:
+		case GL_RG16:
+		case GL_RG16_SNORM:
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_R32UI:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+			return 4;
+		case GL_RGB16F:
+		case GL_RGB16:
+			return 6;
+		case GL_RGBA16:
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_RG32UI:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_RGB32F:
+			return 12;
+		case GL_RGBA32F:
+		case GL_RGBA32UI:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	int mipLevelCount(unsigned int width, unsigned int height) {
+		int levels = 1;
+		unsigned int size = std::max(width, height);
+		while (size > 1) {
+			size >>= 1;
+			levels++;
+		}
+		return levels;
+	}
+
+	size_t textureBytes(int internalFormat, unsigned int width, unsigned int height, unsigned int layers, unsigned int mips, unsigned int samples) {
+		size_t bytes = 0;
+		size_t texel = bytesPerPixel(internalFormat);
+		for (unsigned int i = 0; i < mips; i++) {
+			bytes += (size_t)width * height * texel;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		return bytes * layers * samples;
+	}
+
+	int trackGpuAllocation(GpuMemoryCategory category, const std::string& name, size_t bytes) {
+		Allocation allocation;
+		allocation.category = category;
+		allocation.name = name;
+		allocation.bytes = bytes;
+		allocation.peakBytes = bytes;
+		int id = nextAllocationId++;
+		allocations[id] = allocation;
+
+		categoryBytes[(int)category] += bytes;
+		totalBytes += bytes;
+		updatePeaks(category);
+		return id;
+	}
+
+	void resizeGpuAllocation(int id, size_t bytes) {
+		auto it = allocations.find(id);
+		if (it == allocations.end())
+			return;
+		Allocation& allocation = it->second;
+		categoryBytes[(int)allocation.category] += bytes - allocation.bytes;
+		totalBytes += bytes - allocation.bytes;
+		allocation.bytes = bytes;
+		allocation.peakBytes = std::max(allocation.peakBytes, bytes);
+		updatePeaks(allocation.category);
+	}
+
+	void releaseGpuAllocation(int id) {
+		auto it = allocations.find(id);
+		if (it == allocations.end())
+			return;
+		categoryBytes[(int)it->second.category] -= it->second.bytes;
+		totalBytes -= it->second.bytes;
+		allocations.erase(it);
+	}
+
+	GpuMemoryStats getGpuMemoryStats() {
+		GpuMemoryStats stats;
+		for (int i = 0; i < (int)GpuMemoryCategory::COUNT; i++) {
+			stats.currentBytes[i] = categoryBytes[i];
+			stats.peakBytes[i] = categoryPeakBytes[i];
+		}
+		stats.totalBytes = totalBytes;
+		stats.totalPeakBytes = totalPeakBytes;
+		stats.allocationCount = (int)allocations.size();
+		return stats;
+	}
+
+	std::vector<GpuAllocationInfo> getGpuAllocations() {
+		std::vector<GpuAllocationInfo> result;
+		for (auto& it : allocations) {
+			GpuAllocationInfo info;
+			info.id = it.first;
+			info.category = it.second.category;
+			info.name = it.second.name;
+			info.bytes = it.second.bytes;
+			info.peakBytes = it.second.peakBytes;
+			result.push_back(info);
+		}
+		return result;
+	}
+}
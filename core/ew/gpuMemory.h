@@ -0,0 +1,51 @@
+//ew/gpuMemory.h
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "external/glad.h"
+
+namespace ew {
+	enum class GpuMemoryCategory {
+		TEXTURE = 0,
+		RENDER_TARGET,
+		SHADOW_MAP,
+		VERTEX_BUFFER,
+		INDEX_BUFFER,
+		UNIFORM_BUFFER,
+		STORAGE_BUFFER,
+		COUNT
+	};
+
+	struct GpuMemoryStats {
+		size_t currentBytes[(int)GpuMemoryCategory::COUNT];
+		size_t peakBytes[(int)GpuMemoryCategory::COUNT];
+		size_t totalBytes;
+		size_t totalPeakBytes;
+		int allocationCount;
+	};
+
+	struct GpuAllocationInfo {
+		int id;
+		GpuMemoryCategory category;
+		std::string name;
+		size_t bytes;
+		size_t peakBytes;
+	};
+
+	const char* getGpuMemoryCategoryName(GpuMemoryCategory category);
+	//Estimated size of one texel. RGB formats count 3 components even though drivers may pad them.
+	size_t bytesPerPixel(int internalFormat);
+	int mipLevelCount(unsigned int width, unsigned int height);
+	//format x dimensions x mips x samples. Each mip level is half the size of the previous one.
+	size_t textureBytes(int internalFormat, unsigned int width, unsigned int height, unsigned int layers = 1, unsigned int mips = 1, unsigned int samples = 1);
+
+	//Every allocation path in ew and sh registers here. Returns an id for resize/release.
+	//Lives in ew so meshes and textures can register without ew depending on sh.
+	int trackGpuAllocation(GpuMemoryCategory category, const std::string& name, size_t bytes);
+	void resizeGpuAllocation(int id, size_t bytes);
+	void releaseGpuAllocation(int id);
+
+	GpuMemoryStats getGpuMemoryStats();
+	std::vector<GpuAllocationInfo> getGpuAllocations();
+}
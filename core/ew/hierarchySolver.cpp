@@ -0,0 +1,145 @@
+#include "hierarchySolver.h"
+#include <stdio.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace ew {
+	//Nodes per parallelFor chunk, levels smaller than this run on the calling thread
+	static const int SOLVE_CHUNK_SIZE = 2048;
+
+	static inline void multiply(const glm::mat4& parent, const glm::mat4& local, glm::mat4& out) {
+#ifdef __AVX2__
+		//Each half of a register holds one output column, built from the parent's columns
+		//weighted by that column of the local matrix
+		const float* p = &parent[0][0];
+		const float* l = &local[0][0];
+		float* o = &out[0][0];
+		__m256 p0 = _mm256_broadcast_ps((const __m128*)(p + 0));
+		__m256 p1 = _mm256_broadcast_ps((const __m128*)(p + 4));
+		__m256 p2 = _mm256_broadcast_ps((const __m128*)(p + 8));
+		__m256 p3 = _mm256_broadcast_ps((const __m128*)(p + 12));
+		for (int half = 0; half < 2; half++) {
+			__m256 columns = _mm256_loadu_ps(l + half * 8);
+			__m256 r = _mm256_mul_ps(p0, _mm256_shuffle_ps(columns, columns, 0x00));
+			r = _mm256_add_ps(r, _mm256_mul_ps(p1, _mm256_shuffle_ps(columns, columns, 0x55)));
+			r = _mm256_add_ps(r, _mm256_mul_ps(p2, _mm256_shuffle_ps(columns, columns, 0xAA)));
+			r = _mm256_add_ps(r, _mm256_mul_ps(p3, _mm256_shuffle_ps(columns, columns, 0xFF)));
+			_mm256_storeu_ps(o + half * 8, r);
+		}
+#else
+		out = parent * local;
+#endif
+	}
+
+	void HierarchySolver::build(const int* parents, int count) {
+		m_parents.assign(parents, parents + count);
+		m_levels.assign(count, 0);
+		int levelCount = count > 0 ? 1 : 0;
+		for (int i = 0; i < count; i++) {
+			int parent = m_parents[i];
+			if (parent >= i) {
+				printf("Hierarchy node %d comes before its parent %d, solved as a root instead\n", i, parent);
+				m_parents[i] = parent = -1;
+			}
+			m_levels[i] = parent < 0 ? 0 : m_levels[parent] + 1;
+			levelCount = glm::max(levelCount, m_levels[i] + 1);
+		}
+
+		//Counting sort by level keeps index order within a level
+		m_levelStart.assign(levelCount + 1, 0);
+		for (int i = 0; i < count; i++)
+			m_levelStart[m_levels[i] + 1]++;
+		for (int l = 0; l < levelCount; l++)
+			m_levelStart[l + 1] += m_levelStart[l];
+		m_order.resize(count);
+		std::vector<int> next(m_levelStart.begin(), m_levelStart.end() - 1);
+		for (int i = 0; i < count; i++)
+			m_order[next[m_levels[i]]++] = i;
+
+		m_childStart.assign(count + 1, 0);
+		for (int i = 0; i < count; i++) {
+			if (m_parents[i] >= 0)
+				m_childStart[m_parents[i] + 1]++;
+		}
+		for (int i = 0; i < count; i++)
+			m_childStart[i + 1] += m_childStart[i];
+		m_children.resize(m_childStart[count]);
+		next.assign(m_childStart.begin(), m_childStart.end() - 1);
+		for (int i = 0; i < count; i++) {
+			if (m_parents[i] >= 0)
+				m_children[next[m_parents[i]]++] = i;
+		}
+
+		m_marked.clear();
+		m_queued.assign(count, 0);
+		m_levelQueues.assign(levelCount, std::vector<int>());
+		m_stats = {};
+		m_stats.nodeCount = count;
+		m_stats.levelCount = levelCount;
+	}
+
+	void HierarchySolver::solveNodes(const int* nodes, int count, const glm::mat4* local, glm::mat4* world, ThreadPool* pool) const {
+		auto solveRange = [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				int node = nodes[i];
+				int parent = m_parents[node];
+				if (parent < 0)
+					world[node] = local[node];
+				else
+					multiply(world[parent], local[node], world[node]);
+			}
+		};
+		if (pool)
+			pool->parallelFor(count, SOLVE_CHUNK_SIZE, solveRange);
+		else
+			solveRange(0, count);
+	}
+
+	void HierarchySolver::solve(const glm::mat4* local, glm::mat4* world, ThreadPool* pool) {
+		for (int l = 0; l < getLevelCount(); l++) {
+			solveNodes(&m_order[m_levelStart[l]], m_levelStart[l + 1] - m_levelStart[l], local, world, pool);
+		}
+		//Everything is up to date, so nothing marked so far needs solving again
+		for (int node : m_marked)
+			m_queued[node] = 0;
+		m_marked.clear();
+		m_stats.solvedNodes = getNodeCount();
+	}
+
+	void HierarchySolver::markChanged(int node) {
+		if (m_queued[node])
+			return;
+		m_queued[node] = 1;
+		m_marked.push_back(node);
+	}
+
+	void HierarchySolver::solveChanged(const glm::mat4* local, glm::mat4* world, ThreadPool* pool) {
+		m_stats.solvedNodes = 0;
+		if (m_marked.empty())
+			return;
+		for (int node : m_marked)
+			m_levelQueues[m_levels[node]].push_back(node);
+		m_marked.clear();
+
+		//A level's queue is complete once every level above it has been expanded
+		for (int l = 0; l < getLevelCount(); l++) {
+			std::vector<int>& queue = m_levelQueues[l];
+			if (queue.empty())
+				continue;
+			solveNodes(queue.data(), (int)queue.size(), local, world, pool);
+			m_stats.solvedNodes += (int)queue.size();
+			for (int node : queue) {
+				m_queued[node] = 0;
+				for (int c = m_childStart[node]; c < m_childStart[node + 1]; c++) {
+					int child = m_children[c];
+					if (m_queued[child])
+						continue;
+					m_queued[child] = 1;
+					m_levelQueues[l + 1].push_back(child);
+				}
+			}
+			queue.clear();
+		}
+	}
+}
@@ -0,0 +1,50 @@
+//ew/hierarchySolver.h
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "threadPool.h"
+
+namespace ew {
+	struct HierarchySolveStats {
+		int nodeCount;
+		int levelCount; //Depth of the deepest node plus one
+		int solvedNodes; //World matrices computed by the last solve
+	};
+
+	//Forward kinematics for large hierarchies: world = parent world * local for every node.
+	//build() groups nodes by depth, so every node of a level only depends on levels before it and a
+	//level can be split across a thread pool. Multiplies use AVX two columns at a time when core
+	//is built with AVX2.
+	//For sparse changes, markChanged() the nodes whose local matrix changed and solveChanged() only
+	//recomputes them and their descendants, found through child lists instead of a scan of every node.
+	class HierarchySolver {
+	public:
+		//parents[i] is -1 for roots and must be less than i, as in ew::Scene
+		void build(const int* parents, int count);
+		//Every node, level by level
+		void solve(const glm::mat4* local, glm::mat4* world, ThreadPool* pool = nullptr);
+		void markChanged(int node);
+		//Nodes marked since the last solve and everything below them
+		void solveChanged(const glm::mat4* local, glm::mat4* world, ThreadPool* pool = nullptr);
+
+		int getNodeCount() const { return (int)m_parents.size(); }
+		int getLevelCount() const { return (int)m_levelStart.size() - 1; }
+		const HierarchySolveStats& getStats() const { return m_stats; }
+	private:
+		void solveNodes(const int* nodes, int count, const glm::mat4* local, glm::mat4* world, ThreadPool* pool) const;
+
+		std::vector<int> m_parents;
+		std::vector<int> m_levels; //Per node
+		std::vector<int> m_order; //Nodes sorted by level, then index
+		std::vector<int> m_levelStart; //Range of each level in m_order, one extra entry at the end
+		//Children of node i are m_children[m_childStart[i] .. m_childStart[i + 1])
+		std::vector<int> m_childStart;
+		std::vector<int> m_children;
+		//Incremental solve
+		std::vector<int> m_marked;
+		std::vector<uint8_t> m_queued;
+		std::vector<std::vector<int>> m_levelQueues;
+		HierarchySolveStats m_stats = {};
+	};
+}
@@ -7,6 +7,7 @@
 
 #include "mesh.h"
 #include "external/glad.h"
+#include "gpuMemory.h"
 
 namespace ew {
 	Mesh::Mesh(const MeshData& meshData)
@@ -45,11 +46,27 @@ namespace ew {
 
 		if (meshData.vertices.size() > 0) {
 			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+			if (m_vertexMemoryId < 0)
+				m_vertexMemoryId = trackGpuAllocation(GpuMemoryCategory::VERTEX_BUFFER, "Mesh vertices", sizeof(Vertex) * meshData.vertices.size());
+			else
+				resizeGpuAllocation(m_vertexMemoryId, sizeof(Vertex) * meshData.vertices.size());
 		}
 		if (meshData.indices.size() > 0) {
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+			if (m_indexMemoryId < 0)
+				m_indexMemoryId = trackGpuAllocation(GpuMemoryCategory::INDEX_BUFFER, "Mesh indices", sizeof(unsigned int) * meshData.indices.size());
+			else
+				resizeGpuAllocation(m_indexMemoryId, sizeof(unsigned int) * meshData.indices.size());
 		}
 		m_numVertices = meshData.vertices.size();
+		if (meshData.vertices.size() > 0) {
+			m_boundsMin = m_boundsMax = meshData.vertices[0].pos;
+			for (size_t i = 1; i < meshData.vertices.size(); i++)
+			{
+				m_boundsMin = glm::min(m_boundsMin, meshData.vertices[i].pos);
+				m_boundsMax = glm::max(m_boundsMax, meshData.vertices[i].pos);
+			}
+		}
 		m_numIndices = meshData.indices.size();
 
 		glBindVertexArray(0);
@@ -67,4 +84,14 @@ namespace ew {
 		}
 		
 	}
+	void Mesh::drawInstanced(int instanceCount, ew::DrawMode drawMode) const
+	{
+		glBindVertexArray(m_vao);
+		if (drawMode == DrawMode::TRIANGLES) {
+			glDrawElementsInstanced(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL, instanceCount);
+		}
+		else {
+			glDrawArraysInstanced(GL_POINTS, 0, m_numVertices, instanceCount);
+		}
+	}
 }
\ No newline at end of file
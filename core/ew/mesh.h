@@ -29,8 +29,13 @@ namespace ew {
 		Mesh(const MeshData& meshData);
 		void load(const MeshData& meshData);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Draws instanceCount copies in one call, shaders tell them apart with gl_InstanceID
+		void drawInstanced(int instanceCount, DrawMode drawMode = DrawMode::TRIANGLES)const;
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		//Object space bounding box of the vertices
+		inline const glm::vec3& getBoundsMin()const { return m_boundsMin; }
+		inline const glm::vec3& getBoundsMax()const { return m_boundsMax; }
 	private:
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
@@ -38,5 +43,9 @@ namespace ew {
 		unsigned int m_ebo = 0;
 		unsigned int m_numVertices = 0;
 		unsigned int m_numIndices = 0;
+		int m_vertexMemoryId = -1;
+		int m_indexMemoryId = -1;
+		glm::vec3 m_boundsMin = glm::vec3(0.0f);
+		glm::vec3 m_boundsMax = glm::vec3(0.0f);
 	};
 }
\ No newline at end of file
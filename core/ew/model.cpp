@@ -20,6 +20,14 @@ namespace ew {
 		{
 			aiMesh* aiMesh = aiScene->mMeshes[i];
 			m_meshes.push_back(processAiMesh(aiMesh));
+			if (i == 0) {
+				m_boundsMin = m_meshes[i].getBoundsMin();
+				m_boundsMax = m_meshes[i].getBoundsMax();
+			}
+			else {
+				m_boundsMin = glm::min(m_boundsMin, m_meshes[i].getBoundsMin());
+				m_boundsMax = glm::max(m_boundsMax, m_meshes[i].getBoundsMax());
+			}
 		}
 	}
 
@@ -12,7 +12,12 @@ namespace ew {
 	public:
 		Model(const std::string& filePath);
 		void draw();
+		//Object space bounding box of every mesh
+		inline const glm::vec3& getBoundsMin()const { return m_boundsMin; }
+		inline const glm::vec3& getBoundsMax()const { return m_boundsMax; }
 	private:
 		std::vector<ew::Mesh> m_meshes;
+		glm::vec3 m_boundsMin = glm::vec3(0.0f);
+		glm::vec3 m_boundsMax = glm::vec3(0.0f);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "scene.h"
+#include <stdio.h>
+#include <algorithm>
+
+namespace ew {
+	//Rotation and scale go straight into the columns instead of multiplying three matrices
+	static glm::mat4 composeTRS(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+		glm::mat3 r = glm::mat3_cast(rotation);
+		glm::mat4 m;
+		m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+		m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+		m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+		m[3] = glm::vec4(position, 1.0f);
+		return m;
+	}
+
+	int Scene::createNode(const Transform& local, int parent) {
+		int node = getNodeCount();
+		if (parent >= node) {
+			printf("Scene node %d created before its parent %d, made a root instead\n", node, parent);
+			parent = -1;
+		}
+		m_positions.push_back(local.position);
+		m_rotations.push_back(local.rotation);
+		m_scales.push_back(local.scale);
+		m_parents.push_back(parent);
+		m_dirty.push_back(1);
+		m_updatedFrame.push_back(0);
+		m_meshes.push_back(-1);
+		m_localMin.push_back(glm::vec3(0.0f));
+		m_localMax.push_back(glm::vec3(0.0f));
+		m_worldMatrices.push_back(glm::mat4(1.0f));
+		m_worldMin.push_back(glm::vec3(0.0f));
+		m_worldMax.push_back(glm::vec3(0.0f));
+		m_firstDirty = glm::min(m_firstDirty, node);
+		return node;
+	}
+
+	void Scene::setMesh(int node, int mesh, const glm::vec3& localMin, const glm::vec3& localMax) {
+		int previous = m_meshes[node];
+		if (previous >= 0) {
+			std::vector<int>& nodes = m_meshNodes[previous];
+			for (size_t i = 0; i < nodes.size(); i++) {
+				if (nodes[i] == node) {
+					nodes.erase(nodes.begin() + i);
+					break;
+				}
+			}
+		}
+		m_meshes[node] = mesh;
+		m_localMin[node] = localMin;
+		m_localMax[node] = localMax;
+		if (mesh >= 0) {
+			if (mesh >= (int)m_meshNodes.size())
+				m_meshNodes.resize(mesh + 1);
+			//Kept sorted so draw order follows the hierarchy
+			std::vector<int>& nodes = m_meshNodes[mesh];
+			nodes.insert(std::upper_bound(nodes.begin(), nodes.end(), node), node);
+		}
+		markDirty(node);
+	}
+
+	void Scene::clear() {
+		*this = Scene();
+	}
+
+	void Scene::setLocalTransform(int node, const Transform& local) {
+		m_positions[node] = local.position;
+		m_rotations[node] = local.rotation;
+		m_scales[node] = local.scale;
+		markDirty(node);
+	}
+
+	Transform Scene::getLocalTransform(int node) const {
+		Transform local;
+		local.position = m_positions[node];
+		local.rotation = m_rotations[node];
+		local.scale = m_scales[node];
+		return local;
+	}
+
+	const std::vector<int>& Scene::getMeshNodes(int mesh) const {
+		static const std::vector<int> none;
+		if (mesh < 0 || mesh >= (int)m_meshNodes.size())
+			return none;
+		return m_meshNodes[mesh];
+	}
+
+	void Scene::markDirty(int node) {
+		m_dirty[node] = 1;
+		m_firstDirty = glm::min(m_firstDirty, node);
+	}
+
+	void Scene::updateWorldTransforms() {
+		int count = getNodeCount();
+		m_stats.nodeCount = count;
+		m_stats.updatedNodes = 0;
+		//Frame 0 is what new nodes start with, so it never means updated
+		m_frame++;
+		if (m_frame == 0)
+			m_frame = 1;
+		if (m_firstDirty >= count)
+			return;
+
+		for (int i = m_firstDirty; i < count; i++) {
+			int parent = m_parents[i];
+			bool parentMoved = parent >= 0 && m_updatedFrame[parent] == m_frame;
+			if (!m_dirty[i] && !parentMoved)
+				continue;
+
+			glm::mat4 local = composeTRS(m_positions[i], m_rotations[i], m_scales[i]);
+			m_worldMatrices[i] = parent >= 0 ? m_worldMatrices[parent] * local : local;
+			m_dirty[i] = 0;
+			m_updatedFrame[i] = m_frame;
+			m_stats.updatedNodes++;
+
+			//Box around the transformed box: center moves with the matrix, extents through its absolute value.
+			//Nodes without a mesh end up with an empty box at their origin.
+			const glm::mat4& m = m_worldMatrices[i];
+			glm::vec3 center = (m_localMin[i] + m_localMax[i]) * 0.5f;
+			glm::vec3 extent = (m_localMax[i] - m_localMin[i]) * 0.5f;
+			glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+			glm::vec3 worldExtent = glm::abs(glm::vec3(m[0])) * extent.x + glm::abs(glm::vec3(m[1])) * extent.y + glm::abs(glm::vec3(m[2])) * extent.z;
+			m_worldMin[i] = worldCenter - worldExtent;
+			m_worldMax[i] = worldCenter + worldExtent;
+		}
+		m_firstDirty = count;
+	}
+}
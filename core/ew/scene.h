@@ -0,0 +1,83 @@
+//ew/scene.h
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "transform.h"
+
+namespace ew {
+	struct SceneStats {
+		int nodeCount;
+		int updatedNodes; //World matrices recomputed by the last updateWorldTransforms()
+	};
+
+	//Data oriented store for scene objects. Every field is its own array indexed by node, so
+	//passes that only need world matrices or bounds walk one contiguous array.
+	//Parents must be created before their children, which keeps the arrays in topological order:
+	//a single forward walk always sees a parent's world matrix before any of its children.
+	//Setting a local transform only marks the node dirty. updateWorldTransforms() is called once per
+	//frame and recomputes dirty nodes and everything below them, every other node keeps last frame's
+	//world matrix and bounds.
+	//Mesh references are ids picked by the caller. Nodes are also grouped by mesh so a draw loop
+	//only visits the nodes that use the mesh it is drawing.
+	class Scene {
+	public:
+		//parent is -1 for a root. Returns the new node's index, which stays valid until clear().
+		int createNode(const Transform& local = Transform(), int parent = -1);
+		//Bounds are of the mesh in its own space, the node's world bounds are kept around them
+		void setMesh(int node, int mesh, const glm::vec3& localMin, const glm::vec3& localMax);
+		void clear();
+
+		void setLocalTransform(int node, const Transform& local);
+		void setPosition(int node, const glm::vec3& position) { m_positions[node] = position; markDirty(node); }
+		void setRotation(int node, const glm::quat& rotation) { m_rotations[node] = rotation; markDirty(node); }
+		void setScale(int node, const glm::vec3& scale) { m_scales[node] = scale; markDirty(node); }
+		Transform getLocalTransform(int node) const;
+		const glm::vec3& getPosition(int node) const { return m_positions[node]; }
+		const glm::quat& getRotation(int node) const { return m_rotations[node]; }
+		const glm::vec3& getScale(int node) const { return m_scales[node]; }
+
+		void updateWorldTransforms();
+
+		//As of the last updateWorldTransforms()
+		const glm::mat4& getWorldMatrix(int node) const { return m_worldMatrices[node]; }
+		const glm::vec3& getWorldBoundsMin(int node) const { return m_worldMin[node]; }
+		const glm::vec3& getWorldBoundsMax(int node) const { return m_worldMax[node]; }
+		const std::vector<glm::mat4>& getWorldMatrices() const { return m_worldMatrices; }
+		//The node's world matrix and bounds changed in the last updateWorldTransforms()
+		bool wasUpdated(int node) const { return m_updatedFrame[node] == m_frame; }
+
+		int getParent(int node) const { return m_parents[node]; }
+		//-1 for nodes without a mesh
+		int getMesh(int node) const { return m_meshes[node]; }
+		const glm::vec3& getLocalBoundsMin(int node) const { return m_localMin[node]; }
+		const glm::vec3& getLocalBoundsMax(int node) const { return m_localMax[node]; }
+		//Nodes using a mesh, in topological order
+		const std::vector<int>& getMeshNodes(int mesh) const;
+		int getNodeCount() const { return (int)m_parents.size(); }
+		const SceneStats& getStats() const { return m_stats; }
+	private:
+		void markDirty(int node);
+
+		//Local transform
+		std::vector<glm::vec3> m_positions;
+		std::vector<glm::quat> m_rotations;
+		std::vector<glm::vec3> m_scales;
+		//Hierarchy, parents always have a lower index
+		std::vector<int> m_parents;
+		std::vector<uint8_t> m_dirty;
+		std::vector<uint32_t> m_updatedFrame; //Last update that recomputed the node
+		//Renderable
+		std::vector<int> m_meshes;
+		std::vector<glm::vec3> m_localMin, m_localMax;
+		std::vector<std::vector<int>> m_meshNodes;
+		//Derived
+		std::vector<glm::mat4> m_worldMatrices;
+		std::vector<glm::vec3> m_worldMin, m_worldMax;
+
+		int m_firstDirty = 0; //Nothing before this index needs updating
+		uint32_t m_frame = 0;
+		SceneStats m_stats = {};
+	};
+}
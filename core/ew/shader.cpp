@@ -26,6 +26,34 @@ namespace ew {
 		return buffer.str();
 	}
 
+	/// <summary>
+	/// Inserts a #define line for each entry right after the #version directive,
+	/// so one source file can be compiled into several variants.
+	/// </summary>
+	/// <param name="source">GLSL source code</param>
+	/// <param name="defines">Entries like "COMPACT_GBUFFER" or "TAP_COUNT 8"</param>
+	/// <returns></returns>
+	std::string addShaderDefines(const std::string& source, const std::vector<std::string>& defines) {
+		if (defines.empty()) {
+			return source;
+		}
+		std::string defineBlock;
+		for (size_t i = 0; i < defines.size(); i++)
+		{
+			defineBlock += "#define " + defines[i] + "\n";
+		}
+		//#version has to stay the first directive
+		size_t versionPos = source.find("#version");
+		if (versionPos == std::string::npos) {
+			return defineBlock + source;
+		}
+		size_t lineEnd = source.find('\n', versionPos);
+		if (lineEnd == std::string::npos) {
+			return source + "\n" + defineBlock;
+		}
+		return source.substr(0, lineEnd + 1) + defineBlock + source.substr(lineEnd + 1);
+	}
+
 	/// <summary>
 	/// Creates and compiles a shader object of a given type
 	/// </summary>
@@ -79,6 +107,56 @@ namespace ew {
 		return shaderProgram;
 	}
 	/// <summary>
+	/// Creates a shader program with vertex, geometry and fragment shaders
+	/// </summary>
+	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
+	/// <param name="geometryShaderSource">GLSL source code for the geometry shader</param>
+	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* geometryShaderSource, const char* fragmentShaderSource) {
+		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
+		unsigned int geometryShader = createShader(GL_GEOMETRY_SHADER, geometryShaderSource);
+		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+
+		unsigned int shaderProgram = glCreateProgram();
+		glAttachShader(shaderProgram, vertexShader);
+		glAttachShader(shaderProgram, geometryShader);
+		glAttachShader(shaderProgram, fragmentShader);
+		glLinkProgram(shaderProgram);
+		int success;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+		if (!success) {
+			char infoLog[512];
+			glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+			printf("Failed to link shader program: %s", infoLog);
+		}
+		glDeleteShader(vertexShader);
+		glDeleteShader(geometryShader);
+		glDeleteShader(fragmentShader);
+		return shaderProgram;
+	}
+	/// <summary>
+	/// Creates a shader program with a single compute shader
+	/// </summary>
+	/// <param name="computeShaderSource">GLSL source code for the compute shader</param>
+	/// <returns></returns>
+	unsigned int createComputeProgram(const char* computeShaderSource) {
+		unsigned int computeShader = createShader(GL_COMPUTE_SHADER, computeShaderSource);
+
+		unsigned int shaderProgram = glCreateProgram();
+		glAttachShader(shaderProgram, computeShader);
+		glLinkProgram(shaderProgram);
+		int success;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+		if (!success) {
+			char infoLog[512];
+			glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+			printf("Failed to link shader program: %s", infoLog);
+		}
+		glDeleteShader(computeShader);
+		return shaderProgram;
+	}
+	/// <summary>
 	/// Creates a shader instance with vertex + fragment stages
 	/// </summary>
 	/// <param name="vertexShader">File path to vertex shader</param>
@@ -89,6 +167,44 @@ namespace ew {
 		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
 		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
 	}
+	/// <summary>
+	/// Creates a shader instance with vertex + fragment stages, compiled with extra #defines
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	/// <param name="defines">Added to both stages, see addShaderDefines</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines)
+	{
+		std::string vertexShaderSource = ew::addShaderDefines(ew::loadShaderSourceFromFile(vertexShader.c_str()), defines);
+		std::string fragmentShaderSource = ew::addShaderDefines(ew::loadShaderSourceFromFile(fragmentShader.c_str()), defines);
+		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+	}
+	/// <summary>
+	/// Creates a shader instance with vertex + geometry + fragment stages
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="geometryShader">File path to geometry shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	/// <param name="defines">Added to every stage, see addShaderDefines</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader, const std::vector<std::string>& defines)
+	{
+		std::string vertexShaderSource = ew::addShaderDefines(ew::loadShaderSourceFromFile(vertexShader.c_str()), defines);
+		std::string geometryShaderSource = ew::addShaderDefines(ew::loadShaderSourceFromFile(geometryShader.c_str()), defines);
+		std::string fragmentShaderSource = ew::addShaderDefines(ew::loadShaderSourceFromFile(fragmentShader.c_str()), defines);
+		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), geometryShaderSource.c_str(), fragmentShaderSource.c_str());
+	}
+	/// <summary>
+	/// Creates a shader instance with only a compute stage
+	/// </summary>
+	/// <param name="computeShader">File path to compute shader</param>
+	/// <param name="defines">See addShaderDefines</param>
+	Shader Shader::createCompute(const std::string& computeShader, const std::vector<std::string>& defines)
+	{
+		std::string computeShaderSource = ew::addShaderDefines(ew::loadShaderSourceFromFile(computeShader.c_str()), defines);
+		Shader shader;
+		shader.m_id = ew::createComputeProgram(computeShaderSource.c_str());
+		return shader;
+	}
 	void Shader::use()const
 	{
 		glUseProgram(m_id);
@@ -129,5 +245,12 @@ namespace ew {
 	{
 		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(m));
 	}
-}
-
+	void Shader::dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) const
+	{
+		glDispatchCompute(groupsX, groupsY, groupsZ);
+	}
+	void Shader::setMat4Array(const std::string& name, const glm::mat4* m, int count) const
+	{
+		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), count, GL_FALSE, glm::value_ptr(m[0]));
+	}
+}
\ No newline at end of file
@@ -4,14 +4,22 @@
 
 #pragma once
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace ew {
 	std::string loadShaderSourceFromFile(const std::string& filePath);
+	std::string addShaderDefines(const std::string& source, const std::vector<std::string>& defines);
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* geometryShaderSource, const char* fragmentShaderSource);
+	unsigned int createComputeProgram(const char* computeShaderSource);
 	class Shader {
 	public:
 		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		Shader(const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines);
+		Shader(const std::string& vertexShader, const std::string& geometryShader, const std::string& fragmentShader, const std::vector<std::string>& defines);
+		//A compute-only program. Not a constructor, (path, defines) would be ambiguous with (vertex, fragment).
+		static Shader createCompute(const std::string& computeShader, const std::vector<std::string>& defines = {});
 		void use()const;
 		void setInt(const std::string& name, int v) const;
 		void setFloat(const std::string& name, float v) const;
@@ -22,7 +30,11 @@ namespace ew {
 		void setVec4(const std::string& name, float x, float y, float z, float w) const;
 		void setVec4(const std::string& name, const glm::vec4& v) const;
 		void setMat4(const std::string& name, const glm::mat4& m) const;
+		void setMat4Array(const std::string& name, const glm::mat4* m, int count) const;
+		//Runs a compute program over the given number of work groups
+		void dispatch(unsigned int groupsX, unsigned int groupsY = 1, unsigned int groupsZ = 1) const;
 	private:
+		Shader() {};
 		unsigned int m_id; //Shader program handle
 	};
 }
\ No newline at end of file
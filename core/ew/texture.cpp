@@ -5,20 +5,37 @@
 #include "texture.h"
 #include "external/glad.h"
 #include "external/stb_image.h"
+#include "gpuMemory.h"
+#include <map>
 
-static int getTextureFormat(int numComponents) {
-	switch (numComponents) {
-	default:
-		return GL_RGBA;
-	case 3:
-		return GL_RGB;
-	case 2:
-		return GL_RG;
-	case 1:
-		return GL_RED;
-	}
-}
 namespace ew {
+	int getTextureFormat(int numComponents) {
+		switch (numComponents) {
+		default:
+			return GL_RGBA;
+		case 3:
+			return GL_RGB;
+		case 2:
+			return GL_RG;
+		case 1:
+			return GL_RED;
+		}
+	}
+	int getSizedTextureFormat(int numComponents) {
+		switch (numComponents) {
+		default:
+			return GL_RGBA8;
+		case 3:
+			return GL_RGB8;
+		case 2:
+			return GL_RG8;
+		case 1:
+			return GL_R8;
+		}
+	}
+	//Tracker id of every texture loadTexture() created, so deleteTexture() can release it
+	static std::map<unsigned int, int> textureMemoryIds;
+
 	unsigned int loadTexture(const char* filePath) {
 		stbi_set_flip_vertically_on_load(true);
 		return loadTexture(filePath, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true);
@@ -49,9 +66,21 @@ namespace ew {
 			glGenerateMipmap(GL_TEXTURE_2D);
 		}
 
+		//Unsized formats get 8 bits per component from the driver
+		int levels = mipmap ? mipLevelCount(width, height) : 1;
+		textureMemoryIds[texture] = trackGpuAllocation(GpuMemoryCategory::TEXTURE, filePath,
+			textureBytes(getSizedTextureFormat(numComponents), width, height, 1, levels));
+
 		glBindTexture(GL_TEXTURE_2D, 0);
 		stbi_image_free(data);
 		return texture;
 	}
+	void deleteTexture(unsigned int texture) {
+		auto it = textureMemoryIds.find(texture);
+		if (it != textureMemoryIds.end()) {
+			releaseGpuAllocation(it->second);
+			textureMemoryIds.erase(it);
+		}
+		glDeleteTextures(1, &texture);
+	}
 }
-
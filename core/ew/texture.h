@@ -5,6 +5,12 @@
 #pragma once
 
 namespace ew {
+	//Pixel format (GL_RED..GL_RGBA) and 8 bit sized internal format for images with this many components
+	int getTextureFormat(int numComponents);
+	int getSizedTextureFormat(int numComponents);
+
 	unsigned int loadTexture(const char* filePath);
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap);
+	//Deletes a texture from loadTexture() and releases its tracked memory
+	void deleteTexture(unsigned int texture);
 }
@@ -0,0 +1,90 @@
+#include "threadPool.h"
+#include <algorithm>
+
+namespace ew {
+	ThreadPool::ThreadPool(int workerCount) {
+		if (workerCount < 0)
+			workerCount = (int)std::thread::hardware_concurrency() - 1;
+		for (int i = 0; i < workerCount; i++) {
+			m_workers.emplace_back(&ThreadPool::workerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_all();
+		for (std::thread& worker : m_workers) {
+			worker.join();
+		}
+	}
+
+	void ThreadPool::parallelFor(int count, int chunkSize, const std::function<void(int, int)>& fn) {
+		if (count <= 0)
+			return;
+		if (chunkSize < 1)
+			chunkSize = 1;
+		int chunkCount = (count + chunkSize - 1) / chunkSize;
+		if (m_workers.empty() || chunkCount == 1) {
+			for (int begin = 0; begin < count; begin += chunkSize)
+				fn(begin, std::min(begin + chunkSize, count));
+			return;
+		}
+
+		std::lock_guard<std::mutex> call(m_callMutex);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &fn;
+			m_count = count;
+			m_chunkSize = chunkSize;
+			m_chunkCount = chunkCount;
+			m_nextChunk = 0;
+			m_generation++;
+		}
+		m_wake.notify_all();
+		runChunks(&fn, count, chunkSize, chunkCount);
+		{
+			//Workers that wake after this see no job, so fn can't be called once this returns
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock, [&] { return m_activeWorkers == 0; });
+			m_job = nullptr;
+		}
+	}
+
+	void ThreadPool::workerLoop() {
+		unsigned int seen = 0;
+		while (true) {
+			const std::function<void(int, int)>* fn;
+			int count, chunkSize, chunkCount;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [&] { return m_quit || m_generation != seen; });
+				if (m_quit)
+					return;
+				seen = m_generation;
+				if (!m_job)
+					continue;
+				fn = m_job;
+				count = m_count;
+				chunkSize = m_chunkSize;
+				chunkCount = m_chunkCount;
+				m_activeWorkers++;
+			}
+			runChunks(fn, count, chunkSize, chunkCount);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_activeWorkers--;
+			}
+			m_done.notify_all();
+		}
+	}
+
+	void ThreadPool::runChunks(const std::function<void(int, int)>* fn, int count, int chunkSize, int chunkCount) {
+		for (int chunk = m_nextChunk++; chunk < chunkCount; chunk = m_nextChunk++) {
+			int begin = chunk * chunkSize;
+			(*fn)(begin, std::min(begin + chunkSize, count));
+		}
+	}
+}
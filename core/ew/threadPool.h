@@ -0,0 +1,46 @@
+//ew/threadPool.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ew {
+	//Fixed set of worker threads for splitting loops over large arrays.
+	//parallelFor() blocks until every chunk is done and the calling thread works through chunks
+	//alongside the workers, so a pool with no workers just runs the loop in place.
+	//Only one parallelFor() runs at a time, calls from several threads are serialized.
+	class ThreadPool {
+	public:
+		//workerCount < 0 uses one worker per hardware thread besides the caller's
+		explicit ThreadPool(int workerCount = -1);
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		//Calls fn(begin, end) for consecutive ranges of at most chunkSize covering [0, count)
+		void parallelFor(int count, int chunkSize, const std::function<void(int, int)>& fn);
+		//Workers plus the calling thread
+		int getThreadCount() const { return (int)m_workers.size() + 1; }
+	private:
+		void workerLoop();
+		void runChunks(const std::function<void(int, int)>* fn, int count, int chunkSize, int chunkCount);
+
+		std::vector<std::thread> m_workers;
+		std::mutex m_callMutex; //Held for the whole of a parallelFor()
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		//Current job, written under m_mutex before m_generation is bumped
+		const std::function<void(int, int)>* m_job = nullptr;
+		int m_count = 0;
+		int m_chunkSize = 0;
+		int m_chunkCount = 0;
+		std::atomic<int> m_nextChunk{ 0 };
+		unsigned int m_generation = 0;
+		int m_activeWorkers = 0;
+		bool m_quit = false;
+	};
+}
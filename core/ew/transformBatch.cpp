@@ -0,0 +1,233 @@
+#include "transformBatch.h"
+#include "transform.h"
+#include <float.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace ew {
+	//Transforms per parallelFor chunk, a multiple of the SIMD width
+	static const int BATCH_CHUNK_SIZE = 4096;
+
+	static void buildOne(const TransformBatchInput& input, const TransformBatchOutput& output, int i) {
+		glm::mat3 r = glm::mat3_cast(input.rotations[i]);
+		const glm::vec3& s = input.scales[i];
+		glm::vec3 c0 = r[0] * s.x;
+		glm::vec3 c1 = r[1] * s.y;
+		glm::vec3 c2 = r[2] * s.z;
+		const glm::vec3& p = input.positions[i];
+		if (output.models)
+			output.models[i] = glm::mat4(glm::vec4(c0, 0.0f), glm::vec4(c1, 0.0f), glm::vec4(c2, 0.0f), glm::vec4(p, 1.0f));
+		if (output.normals)
+			output.normals[i] = glm::mat3(r[0] / s.x, r[1] / s.y, r[2] / s.z);
+		if (output.worldMin) {
+			glm::vec3 center = (input.localMin[i] + input.localMax[i]) * 0.5f;
+			glm::vec3 extent = (input.localMax[i] - input.localMin[i]) * 0.5f;
+			glm::vec3 worldCenter = c0 * center.x + c1 * center.y + c2 * center.z + p;
+			glm::vec3 worldExtent = glm::abs(c0) * extent.x + glm::abs(c1) * extent.y + glm::abs(c2) * extent.z;
+			output.worldMin[i] = worldCenter - worldExtent;
+			output.worldMax[i] = worldCenter + worldExtent;
+		}
+	}
+
+#ifdef __AVX2__
+	//Row j of the input is element j of eight values, row k of the output is the eight elements of value k
+	static inline void transpose8(__m256 r[8]) {
+		__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+		__m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+		__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+		__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+		__m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+		__m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+		__m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+		__m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+		__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+		r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+		r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+		r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+		r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+		r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+		r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+		r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+		r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+	}
+
+	static inline __m256 madd(__m256 a, __m256 b, __m256 c) {
+		return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+	}
+
+	//Eight transforms starting at first. Inputs are gathered into one register per component, the
+	//matrix is built a column element at a time and transposed back to one matrix per row on the way out.
+	static void buildEight(const TransformBatchInput& input, const TransformBatchOutput& output, int first, const __m256i quatIndex[4]) {
+		const __m256i vec3Index = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		const float* p = &input.positions[first].x;
+		const float* s = &input.scales[first].x;
+		const float* q = (const float*)&input.rotations[first];
+		__m256 px = _mm256_i32gather_ps(p, vec3Index, 4);
+		__m256 py = _mm256_i32gather_ps(p + 1, vec3Index, 4);
+		__m256 pz = _mm256_i32gather_ps(p + 2, vec3Index, 4);
+		__m256 sx = _mm256_i32gather_ps(s, vec3Index, 4);
+		__m256 sy = _mm256_i32gather_ps(s + 1, vec3Index, 4);
+		__m256 sz = _mm256_i32gather_ps(s + 2, vec3Index, 4);
+		__m256 qx = _mm256_i32gather_ps(q, quatIndex[0], 4);
+		__m256 qy = _mm256_i32gather_ps(q, quatIndex[1], 4);
+		__m256 qz = _mm256_i32gather_ps(q, quatIndex[2], 4);
+		__m256 qw = _mm256_i32gather_ps(q, quatIndex[3], 4);
+
+		//Same expansion as glm::mat3_cast, r[column][row]
+		__m256 one = _mm256_set1_ps(1.0f);
+		__m256 x2 = _mm256_add_ps(qx, qx);
+		__m256 y2 = _mm256_add_ps(qy, qy);
+		__m256 z2 = _mm256_add_ps(qz, qz);
+		__m256 xx = _mm256_mul_ps(qx, x2);
+		__m256 yy = _mm256_mul_ps(qy, y2);
+		__m256 zz = _mm256_mul_ps(qz, z2);
+		__m256 xy = _mm256_mul_ps(qx, y2);
+		__m256 xz = _mm256_mul_ps(qx, z2);
+		__m256 yz = _mm256_mul_ps(qy, z2);
+		__m256 wx = _mm256_mul_ps(qw, x2);
+		__m256 wy = _mm256_mul_ps(qw, y2);
+		__m256 wz = _mm256_mul_ps(qw, z2);
+		__m256 r[3][3];
+		r[0][0] = _mm256_sub_ps(one, _mm256_add_ps(yy, zz));
+		r[0][1] = _mm256_add_ps(xy, wz);
+		r[0][2] = _mm256_sub_ps(xz, wy);
+		r[1][0] = _mm256_sub_ps(xy, wz);
+		r[1][1] = _mm256_sub_ps(one, _mm256_add_ps(xx, zz));
+		r[1][2] = _mm256_add_ps(yz, wx);
+		r[2][0] = _mm256_add_ps(xz, wy);
+		r[2][1] = _mm256_sub_ps(yz, wx);
+		r[2][2] = _mm256_sub_ps(one, _mm256_add_ps(xx, yy));
+		__m256 scale[3] = { sx, sy, sz };
+		__m256 m[3][3];
+		for (int c = 0; c < 3; c++) {
+			for (int e = 0; e < 3; e++)
+				m[c][e] = _mm256_mul_ps(r[c][e], scale[c]);
+		}
+
+		if (output.models) {
+			__m256 zero = _mm256_setzero_ps();
+			__m256 low[8] = { m[0][0], m[0][1], m[0][2], zero, m[1][0], m[1][1], m[1][2], zero };
+			__m256 high[8] = { m[2][0], m[2][1], m[2][2], zero, px, py, pz, one };
+			transpose8(low);
+			transpose8(high);
+			for (int k = 0; k < 8; k++) {
+				float* out = &output.models[first + k][0][0];
+				_mm256_storeu_ps(out, low[k]);
+				_mm256_storeu_ps(out + 8, high[k]);
+			}
+		}
+		if (output.normals) {
+			__m256 inverseScale[3] = { _mm256_div_ps(one, sx), _mm256_div_ps(one, sy), _mm256_div_ps(one, sz) };
+			__m256 n[8] = {
+				_mm256_mul_ps(r[0][0], inverseScale[0]), _mm256_mul_ps(r[0][1], inverseScale[0]), _mm256_mul_ps(r[0][2], inverseScale[0]),
+				_mm256_mul_ps(r[1][0], inverseScale[1]), _mm256_mul_ps(r[1][1], inverseScale[1]), _mm256_mul_ps(r[1][2], inverseScale[1]),
+				_mm256_mul_ps(r[2][0], inverseScale[2]), _mm256_mul_ps(r[2][1], inverseScale[2])
+			};
+			alignas(32) float last[8];
+			_mm256_store_ps(last, _mm256_mul_ps(r[2][2], inverseScale[2]));
+			transpose8(n);
+			//A mat3 is nine floats, the ninth goes in after the first eight
+			for (int k = 0; k < 8; k++) {
+				float* out = &output.normals[first + k][0][0];
+				_mm256_storeu_ps(out, n[k]);
+				out[8] = last[k];
+			}
+		}
+		if (output.worldMin) {
+			const float* lo = &input.localMin[first].x;
+			const float* hi = &input.localMax[first].x;
+			__m256 half = _mm256_set1_ps(0.5f);
+			__m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+			__m256 center[3], extent[3];
+			for (int e = 0; e < 3; e++) {
+				__m256 l = _mm256_i32gather_ps(lo + e, vec3Index, 4);
+				__m256 h = _mm256_i32gather_ps(hi + e, vec3Index, 4);
+				center[e] = _mm256_mul_ps(_mm256_add_ps(l, h), half);
+				extent[e] = _mm256_mul_ps(_mm256_sub_ps(h, l), half);
+			}
+			__m256 position[3] = { px, py, pz };
+			alignas(32) float worldMin[3][8], worldMax[3][8];
+			for (int e = 0; e < 3; e++) {
+				__m256 worldCenter = madd(m[0][e], center[0], madd(m[1][e], center[1], madd(m[2][e], center[2], position[e])));
+				__m256 worldExtent = madd(_mm256_and_ps(m[0][e], absMask), extent[0],
+					madd(_mm256_and_ps(m[1][e], absMask), extent[1], _mm256_mul_ps(_mm256_and_ps(m[2][e], absMask), extent[2])));
+				_mm256_store_ps(worldMin[e], _mm256_sub_ps(worldCenter, worldExtent));
+				_mm256_store_ps(worldMax[e], _mm256_add_ps(worldCenter, worldExtent));
+			}
+			for (int k = 0; k < 8; k++) {
+				output.worldMin[first + k] = glm::vec3(worldMin[0][k], worldMin[1][k], worldMin[2][k]);
+				output.worldMax[first + k] = glm::vec3(worldMax[0][k], worldMax[1][k], worldMax[2][k]);
+			}
+		}
+	}
+#endif
+
+	static void buildRange(const TransformBatchInput& input, const TransformBatchOutput& output, int begin, int end) {
+		int i = begin;
+#ifdef __AVX2__
+		static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::quat) == 4 * sizeof(float), "Batch gathers assume tightly packed glm types");
+		//glm can be configured to store quaternions as wxyz, so component offsets are looked up
+		const glm::quat& probe = input.rotations[begin];
+		const float* base = (const float*)&probe;
+		__m256i quatIndex[4];
+		const float* components[4] = { &probe.x, &probe.y, &probe.z, &probe.w };
+		for (int c = 0; c < 4; c++) {
+			int offset = (int)(components[c] - base);
+			quatIndex[c] = _mm256_setr_epi32(offset, offset + 4, offset + 8, offset + 12, offset + 16, offset + 20, offset + 24, offset + 28);
+		}
+		for (; i + 8 <= end; i += 8) {
+			buildEight(input, output, i, quatIndex);
+		}
+#endif
+		for (; i < end; i++) {
+			buildOne(input, output, i);
+		}
+	}
+
+	void buildTransforms(const TransformBatchInput& input, const TransformBatchOutput& output, ThreadPool* pool) {
+		if (input.count <= 0)
+			return;
+		if (!pool) {
+			buildRange(input, output, 0, input.count);
+			return;
+		}
+		pool->parallelFor(input.count, BATCH_CHUNK_SIZE, [&](int begin, int end) {
+			buildRange(input, output, begin, end);
+		});
+	}
+
+	void buildTransformsScalar(const TransformBatchInput& input, const TransformBatchOutput& output) {
+		for (int i = 0; i < input.count; i++) {
+			Transform transform;
+			transform.position = input.positions[i];
+			transform.rotation = input.rotations[i];
+			transform.scale = input.scales[i];
+			glm::mat4 model = transform.modelMatrix();
+			if (output.models)
+				output.models[i] = model;
+			if (output.normals)
+				output.normals[i] = glm::transpose(glm::inverse(glm::mat3(model)));
+			if (output.worldMin) {
+				glm::vec3 worldMin = glm::vec3(FLT_MAX);
+				glm::vec3 worldMax = glm::vec3(-FLT_MAX);
+				for (int c = 0; c < 8; c++) {
+					glm::vec3 corner = glm::vec3((c & 1) ? input.localMax[i].x : input.localMin[i].x,
+						(c & 2) ? input.localMax[i].y : input.localMin[i].y, (c & 4) ? input.localMax[i].z : input.localMin[i].z);
+					glm::vec3 world = glm::vec3(model * glm::vec4(corner, 1.0f));
+					worldMin = glm::min(worldMin, world);
+					worldMax = glm::max(worldMax, world);
+				}
+				output.worldMin[i] = worldMin;
+				output.worldMax[i] = worldMax;
+			}
+		}
+	}
+}
@@ -0,0 +1,36 @@
+//ew/transformBatch.h
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "threadPool.h"
+
+namespace ew {
+	//Contiguous arrays of transforms, as ew::Scene stores them
+	struct TransformBatchInput {
+		const glm::vec3* positions = nullptr;
+		const glm::quat* rotations = nullptr;
+		const glm::vec3* scales = nullptr;
+		//Boxes in each transform's own space, only needed for world bounds
+		const glm::vec3* localMin = nullptr;
+		const glm::vec3* localMax = nullptr;
+		int count = 0;
+	};
+
+	//Outputs left null are skipped
+	struct TransformBatchOutput {
+		glm::mat4* models = nullptr;
+		//Inverse transpose of the upper 3x3, rotation over scale for a TRS matrix
+		glm::mat3* normals = nullptr;
+		//Boxes around the transformed local boxes, set both or neither
+		glm::vec3* worldMin = nullptr;
+		glm::vec3* worldMax = nullptr;
+	};
+
+	//Builds the same matrices as Transform::modelMatrix() for a whole array at once. The rotation is
+	//expanded from the quaternion and its columns scaled in place, with no 4x4 multiplies, eight
+	//transforms per iteration when core is built with AVX2. With a pool the array is split into
+	//chunks across its threads.
+	void buildTransforms(const TransformBatchInput& input, const TransformBatchOutput& output, ThreadPool* pool = nullptr);
+	//One transform at a time through Transform::modelMatrix() and general matrix math, for comparison
+	void buildTransformsScalar(const TransformBatchInput& input, const TransformBatchOutput& output);
+}
@@ -0,0 +1,131 @@
+#include "cascadedShadowMap.h"
+#include "gpuMemory.h"
+#include <math.h>
+
+namespace sh
+{
+	CascadedShadowMap createCascadedShadowMap(unsigned int resolution, int cascadeCount, ShadowMode mode)
+	{
+		CascadedShadowMap csm;
+		csm.resolution = resolution;
+		csm.cascadeCount = glm::clamp(cascadeCount, 1, MAX_CASCADES);
+
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &csm.shadowMap);
+		glTextureStorage3D(csm.shadowMap, 1, GL_DEPTH_COMPONENT16, resolution, resolution, csm.cascadeCount);
+		setShadowSampling(csm.shadowMap, mode);
+		//Pixels outside of a cascade should have max distance (white)
+		glTextureParameteri(csm.shadowMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTextureParameteri(csm.shadowMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTextureParameterfv(csm.shadowMap, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+		//Attaching the whole array makes the framebuffer layered
+		glCreateFramebuffers(1, &csm.fbo);
+		glNamedFramebufferTexture(csm.fbo, GL_DEPTH_ATTACHMENT, csm.shadowMap, 0);
+		glNamedFramebufferDrawBuffer(csm.fbo, GL_NONE);
+		glNamedFramebufferReadBuffer(csm.fbo, GL_NONE);
+		GLenum fboStatus = glCheckNamedFramebufferStatus(csm.fbo, GL_FRAMEBUFFER);
+		if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Cascaded shadow framebuffer incomplete: %d", fboStatus);
+		}
+
+		for (int i = 0; i < MAX_CASCADES; i++)
+		{
+			csm.layerFbos[i] = 0;
+			csm.viewProj[i] = glm::mat4(1.0f);
+			csm.splitDistances[i] = 0.0f;
+			csm.texelWorldSize[i] = 0.0f;
+			if (i >= csm.cascadeCount)
+				continue;
+			glCreateFramebuffers(1, &csm.layerFbos[i]);
+			glNamedFramebufferTextureLayer(csm.layerFbos[i], GL_DEPTH_ATTACHMENT, csm.shadowMap, 0, i);
+			glNamedFramebufferDrawBuffer(csm.layerFbos[i], GL_NONE);
+			glNamedFramebufferReadBuffer(csm.layerFbos[i], GL_NONE);
+		}
+
+		csm.memoryId = trackGpuAllocation(GpuMemoryCategory::SHADOW_MAP, "Cascaded Shadow Map",
+			textureBytes(GL_DEPTH_COMPONENT16, resolution, resolution, csm.cascadeCount));
+		return csm;
+	}
+
+	void deleteCascadedShadowMap(CascadedShadowMap& csm)
+	{
+		glDeleteFramebuffers(1, &csm.fbo);
+		for (int i = 0; i < csm.cascadeCount; i++)
+		{
+			glDeleteFramebuffers(1, &csm.layerFbos[i]);
+			csm.layerFbos[i] = 0;
+		}
+		glDeleteTextures(1, &csm.shadowMap);
+		releaseGpuAllocation(csm.memoryId);
+		csm.fbo = 0;
+		csm.shadowMap = 0;
+	}
+
+	void computeCascadeSplits(float nearDistance, float farDistance, int count, float lambda, float* outSplits)
+	{
+		for (int i = 1; i <= count; i++)
+		{
+			float t = (float)i / count;
+			float logSplit = nearDistance * powf(farDistance / nearDistance, t);
+			float uniformSplit = nearDistance + (farDistance - nearDistance) * t;
+			outSplits[i - 1] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+		}
+		outSplits[count - 1] = farDistance;
+	}
+
+	void updateCascades(CascadedShadowMap& csm, const ew::Camera& camera, const glm::vec3& toLight,
+		float shadowDistance, float splitLambda, float casterDistance)
+	{
+		float farDistance = glm::min(shadowDistance, camera.farPlane);
+		computeCascadeSplits(camera.nearPlane, farDistance, csm.cascadeCount, splitLambda, csm.splitDistances);
+
+		glm::mat4 invView = glm::inverse(camera.viewMatrix());
+		float tanY = tanf(glm::radians(camera.fov) * 0.5f);
+		float tanX = tanY * camera.aspectRatio;
+		glm::vec3 lightDir = glm::normalize(toLight);
+		glm::vec3 up = fabsf(lightDir.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+
+		float sliceNear = camera.nearPlane;
+		for (int c = 0; c < csm.cascadeCount; c++)
+		{
+			float sliceFar = csm.splitDistances[c];
+
+			//Slice corners in world space
+			glm::vec3 corners[8];
+			glm::vec3 center = glm::vec3(0.0f);
+			for (int i = 0; i < 8; i++)
+			{
+				float z = (i & 4) ? sliceFar : sliceNear;
+				float x = ((i & 1) ? 1.0f : -1.0f) * tanX * z;
+				float y = ((i & 2) ? 1.0f : -1.0f) * tanY * z;
+				corners[i] = glm::vec3(invView * glm::vec4(x, y, -z, 1.0f));
+				center += corners[i];
+			}
+			center /= 8.0f;
+			float radius = 0.0f;
+			for (int i = 0; i < 8; i++)
+			{
+				radius = glm::max(radius, glm::length(corners[i] - center));
+			}
+			//Quantize so float noise doesn't change the size frame to frame
+			radius = ceilf(radius * 16.0f) / 16.0f;
+
+			glm::mat4 view = glm::lookAt(center + lightDir * (radius + casterDistance), center, up);
+			glm::mat4 proj = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + casterDistance);
+
+			//Snap the world origin to a texel so the cascade only moves in whole texel steps
+			glm::mat4 shadowMatrix = proj * view;
+			float halfResolution = csm.resolution * 0.5f;
+			glm::vec4 origin = shadowMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			glm::vec2 texelOrigin = glm::vec2(origin) * halfResolution;
+			glm::vec2 offset = (glm::round(texelOrigin) - texelOrigin) / halfResolution;
+			proj[3][0] += offset.x;
+			proj[3][1] += offset.y;
+
+			csm.viewProj[c] = proj * view;
+			csm.texelWorldSize[c] = 2.0f * radius / csm.resolution;
+			sliceNear = sliceFar;
+		}
+	}
+}
@@ -0,0 +1,43 @@
+//sh/cascadedShadowMap.h
+#pragma once
+
+#include <stdio.h>
+#include <glm/glm.hpp>
+#include "../ew/external/glad.h"
+#include "../ew/camera.h"
+#include "shadowbuffer.h"
+namespace sh
+{
+	const int MAX_CASCADES = 4;
+
+	//One depth texture array layer per cascade. fbo has the whole array attached for layered
+	//rendering (gl_Layer from a geometry shader), layerFbos[i] has just layer i for drawing one
+	//cascade at a time.
+	struct CascadedShadowMap
+	{
+		unsigned int fbo;
+		unsigned int layerFbos[MAX_CASCADES];
+		unsigned int shadowMap; //GL_TEXTURE_2D_ARRAY
+		unsigned int resolution;
+		int cascadeCount;
+		int memoryId; //sh::trackGpuAllocation id
+
+		//Filled by updateCascades
+		glm::mat4 viewProj[MAX_CASCADES];
+		float splitDistances[MAX_CASCADES]; //View space distance where each cascade ends
+		float texelWorldSize[MAX_CASCADES];
+	};
+
+	CascadedShadowMap createCascadedShadowMap(unsigned int resolution = 512, int cascadeCount = MAX_CASCADES, ShadowMode mode = ShadowMode::DEPTH);
+	void deleteCascadedShadowMap(CascadedShadowMap& csm);
+
+	//Practical split scheme: lambda = 0 is uniform, lambda = 1 is logarithmic.
+	//Writes count far distances, the last one is always farDistance.
+	void computeCascadeSplits(float nearDistance, float farDistance, int count, float lambda, float* outSplits);
+	//Fits each cascade around its slice of the camera frustum. Cascades are fitted to a bounding
+	//sphere so their size doesn't change as the camera turns, and snapped to whole texels so they
+	//don't shimmer as it moves. casterDistance pulls the near plane toward the light so casters
+	//outside the slice still land in the map. toLight points from the scene toward the light.
+	void updateCascades(CascadedShadowMap& csm, const ew::Camera& camera, const glm::vec3& toLight,
+		float shadowDistance, float splitLambda, float casterDistance);
+}
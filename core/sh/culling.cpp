@@ -0,0 +1,94 @@
+#include "culling.h"
+#include <math.h>
+
+namespace sh
+{
+	static Plane makePlane(const glm::vec4& p)
+	{
+		float length = glm::length(glm::vec3(p));
+		Plane plane;
+		plane.normal = glm::vec3(p) / length;
+		plane.distance = p.w / length;
+		return plane;
+	}
+
+	Frustum extractFrustum(const glm::mat4& viewProj)
+	{
+		//Rows of the matrix, glm is column major
+		glm::vec4 row0 = glm::vec4(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+		glm::vec4 row1 = glm::vec4(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+		glm::vec4 row2 = glm::vec4(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+		glm::vec4 row3 = glm::vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+		Frustum frustum;
+		frustum.planes[FRUSTUM_LEFT] = makePlane(row3 + row0);
+		frustum.planes[FRUSTUM_RIGHT] = makePlane(row3 - row0);
+		frustum.planes[FRUSTUM_BOTTOM] = makePlane(row3 + row1);
+		frustum.planes[FRUSTUM_TOP] = makePlane(row3 - row1);
+		//OpenGL clip space, -w <= z <= w
+		frustum.planes[FRUSTUM_NEAR] = makePlane(row3 + row2);
+		frustum.planes[FRUSTUM_FAR] = makePlane(row3 - row2);
+		return frustum;
+	}
+
+	Frustum extendTowardEye(const Frustum& frustum)
+	{
+		Frustum extended = frustum;
+		//A plane everything is in front of
+		extended.planes[FRUSTUM_NEAR].normal = glm::vec3(0.0f);
+		extended.planes[FRUSTUM_NEAR].distance = 1.0f;
+		return extended;
+	}
+
+	bool sphereInFrustum(const Frustum& frustum, const BoundingSphere& sphere)
+	{
+		for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+		{
+			const Plane& plane = frustum.planes[i];
+			if (glm::dot(plane.normal, sphere.center) + plane.distance < -sphere.radius)
+				return false;
+		}
+		return true;
+	}
+
+	bool aabbInFrustum(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+		{
+			const Plane& plane = frustum.planes[i];
+			//Corner furthest along the normal
+			glm::vec3 positive = glm::vec3(
+				plane.normal.x >= 0.0f ? boxMax.x : boxMin.x,
+				plane.normal.y >= 0.0f ? boxMax.y : boxMin.y,
+				plane.normal.z >= 0.0f ? boxMax.z : boxMin.z);
+			if (glm::dot(plane.normal, positive) + plane.distance < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	BoundingSphere transformBounds(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model)
+	{
+		BoundingSphere sphere;
+		sphere.center = glm::vec3(model * glm::vec4((localMin + localMax) * 0.5f, 1.0f));
+		float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		sphere.radius = glm::length(localMax - localMin) * 0.5f * scale;
+		return sphere;
+	}
+
+	void transformAABB(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model, glm::vec3& outMin, glm::vec3& outMax)
+	{
+		//Arvo's method: each output axis is the sum of the extremes of each column's contribution
+		outMin = outMax = glm::vec3(model[3]);
+		for (int c = 0; c < 3; c++)
+		{
+			for (int r = 0; r < 3; r++)
+			{
+				float a = model[c][r] * localMin[c];
+				float b = model[c][r] * localMax[c];
+				outMin[r] += fminf(a, b);
+				outMax[r] += fmaxf(a, b);
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+//sh/culling.h
+#pragma once
+
+#include <stdio.h>
+#include <glm/glm.hpp>
+namespace sh
+{
+	//Points on the positive side of a plane satisfy dot(normal, p) + distance >= 0
+	struct Plane
+	{
+		glm::vec3 normal;
+		float distance;
+	};
+
+	enum FrustumPlane
+	{
+		FRUSTUM_LEFT = 0,
+		FRUSTUM_RIGHT,
+		FRUSTUM_BOTTOM,
+		FRUSTUM_TOP,
+		FRUSTUM_NEAR,
+		FRUSTUM_FAR,
+		FRUSTUM_PLANE_COUNT
+	};
+
+	//Inward facing, normalized planes in world space
+	struct Frustum
+	{
+		Plane planes[FRUSTUM_PLANE_COUNT];
+	};
+
+	struct BoundingSphere
+	{
+		glm::vec3 center;
+		float radius;
+	};
+
+	//Gribb/Hartmann plane extraction from a view projection matrix
+	Frustum extractFrustum(const glm::mat4& viewProj);
+	//Ignores the near plane, so anything between the volume and the eye (or light) passes.
+	//Matches shadow passes that draw with GL_DEPTH_CLAMP.
+	Frustum extendTowardEye(const Frustum& frustum);
+	bool sphereInFrustum(const Frustum& frustum, const BoundingSphere& sphere);
+	bool aabbInFrustum(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+	//Sphere around a local bounding box after a model matrix, scaled by the largest axis
+	BoundingSphere transformBounds(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model);
+	//World space box around a local box after a model matrix
+	void transformAABB(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model, glm::vec3& outMin, glm::vec3& outMax);
+
+	struct CullStats
+	{
+		int tested;
+		int drawn;
+		int culledFrustum; //Outside the volume
+		int culledSmall; //Inside, but too small to matter
+	};
+}
@@ -0,0 +1,341 @@
+#include "dynamicBvh.h"
+#include <chrono>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace sh
+{
+	static float surfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		glm::vec3 size = boxMax - boxMin;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static bool contains(const glm::vec3& outerMin, const glm::vec3& outerMax, const glm::vec3& innerMin, const glm::vec3& innerMax)
+	{
+		return glm::all(glm::lessThanEqual(outerMin, innerMin)) && glm::all(glm::lessThanEqual(innerMax, outerMax));
+	}
+
+	int DynamicBvh::allocateNode()
+	{
+		int node;
+		if (m_freeList >= 0)
+		{
+			node = m_freeList;
+			m_freeList = m_nodes[node].parent;
+		}
+		else
+		{
+			node = (int)m_nodes.size();
+			m_nodes.push_back(Node());
+		}
+		Node& n = m_nodes[node];
+		n.parent = -1;
+		n.child[0] = n.child[1] = -1;
+		n.height = 0;
+		n.userData = -1;
+		return node;
+	}
+
+	void DynamicBvh::freeNode(int node)
+	{
+		m_nodes[node].parent = m_freeList;
+		m_nodes[node].height = -1;
+		m_freeList = node;
+	}
+
+	int DynamicBvh::insert(int userData, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		int leaf = allocateNode();
+		m_nodes[leaf].boxMin = boxMin - glm::vec3(m_margin);
+		m_nodes[leaf].boxMax = boxMax + glm::vec3(m_margin);
+		m_nodes[leaf].userData = userData;
+		insertLeaf(leaf);
+		m_proxyCount++;
+		return leaf;
+	}
+
+	void DynamicBvh::remove(int proxy)
+	{
+		removeLeaf(proxy);
+		freeNode(proxy);
+		m_proxyCount--;
+	}
+
+	bool DynamicBvh::update(int proxy, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		Node& leaf = m_nodes[proxy];
+		if (contains(leaf.boxMin, leaf.boxMax, boxMin, boxMax))
+			return false;
+		removeLeaf(proxy);
+		m_nodes[proxy].boxMin = boxMin - glm::vec3(m_margin);
+		m_nodes[proxy].boxMax = boxMax + glm::vec3(m_margin);
+		insertLeaf(proxy);
+		return true;
+	}
+
+	void DynamicBvh::setBounds(int proxy, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		m_nodes[proxy].boxMin = boxMin - glm::vec3(m_margin);
+		m_nodes[proxy].boxMax = boxMax + glm::vec3(m_margin);
+	}
+
+	void DynamicBvh::refit()
+	{
+		if (m_root < 0)
+			return;
+		//Post order: a node is pushed once to visit its children and again, negated, to fit it
+		m_stack.clear();
+		m_stack.push_back(m_root);
+		while (!m_stack.empty())
+		{
+			int entry = m_stack.back();
+			m_stack.pop_back();
+			if (entry < 0)
+			{
+				fitToChildren(~entry);
+				continue;
+			}
+			if (m_nodes[entry].isLeaf())
+				continue;
+			m_stack.push_back(~entry);
+			m_stack.push_back(m_nodes[entry].child[0]);
+			m_stack.push_back(m_nodes[entry].child[1]);
+		}
+	}
+
+	void DynamicBvh::clear()
+	{
+		m_nodes.clear();
+		m_root = -1;
+		m_freeList = -1;
+		m_proxyCount = 0;
+	}
+
+	void DynamicBvh::fitToChildren(int node)
+	{
+		Node& n = m_nodes[node];
+		const Node& a = m_nodes[n.child[0]];
+		const Node& b = m_nodes[n.child[1]];
+		n.boxMin = glm::min(a.boxMin, b.boxMin);
+		n.boxMax = glm::max(a.boxMax, b.boxMax);
+		n.height = 1 + glm::max(a.height, b.height);
+	}
+
+	void DynamicBvh::insertLeaf(int leaf)
+	{
+		if (m_root < 0)
+		{
+			m_root = leaf;
+			m_nodes[leaf].parent = -1;
+			return;
+		}
+
+		//Walk down toward the sibling that makes the tree grow least
+		glm::vec3 leafMin = m_nodes[leaf].boxMin;
+		glm::vec3 leafMax = m_nodes[leaf].boxMax;
+		int index = m_root;
+		while (!m_nodes[index].isLeaf())
+		{
+			const Node& node = m_nodes[index];
+			float area = surfaceArea(node.boxMin, node.boxMax);
+			float combinedArea = surfaceArea(glm::min(node.boxMin, leafMin), glm::max(node.boxMax, leafMax));
+			//Pairing the leaf with this node makes a new parent here
+			float cost = 2.0f * combinedArea;
+			//Going further down grows this node regardless
+			float inheritance = 2.0f * (combinedArea - area);
+			float childCost[2];
+			for (int c = 0; c < 2; c++)
+			{
+				const Node& child = m_nodes[node.child[c]];
+				float grown = surfaceArea(glm::min(child.boxMin, leafMin), glm::max(child.boxMax, leafMax));
+				childCost[c] = (child.isLeaf() ? grown : grown - surfaceArea(child.boxMin, child.boxMax)) + inheritance;
+			}
+			if (cost < childCost[0] && cost < childCost[1])
+				break;
+			index = childCost[0] < childCost[1] ? node.child[0] : node.child[1];
+		}
+
+		int sibling = index;
+		int oldParent = m_nodes[sibling].parent;
+		int newParent = allocateNode();
+		m_nodes[newParent].parent = oldParent;
+		m_nodes[newParent].child[0] = sibling;
+		m_nodes[newParent].child[1] = leaf;
+		m_nodes[sibling].parent = newParent;
+		m_nodes[leaf].parent = newParent;
+		if (oldParent < 0)
+			m_root = newParent;
+		else
+			m_nodes[oldParent].child[m_nodes[oldParent].child[0] == sibling ? 0 : 1] = newParent;
+
+		for (index = newParent; index >= 0; index = m_nodes[index].parent)
+		{
+			index = balance(index);
+			fitToChildren(index);
+		}
+	}
+
+	void DynamicBvh::removeLeaf(int leaf)
+	{
+		if (leaf == m_root)
+		{
+			m_root = -1;
+			return;
+		}
+		int parent = m_nodes[leaf].parent;
+		int grandParent = m_nodes[parent].parent;
+		int sibling = m_nodes[parent].child[0] == leaf ? m_nodes[parent].child[1] : m_nodes[parent].child[0];
+		freeNode(parent);
+		m_nodes[sibling].parent = grandParent;
+		if (grandParent < 0)
+		{
+			m_root = sibling;
+			return;
+		}
+		m_nodes[grandParent].child[m_nodes[grandParent].child[0] == parent ? 0 : 1] = sibling;
+		for (int index = grandParent; index >= 0; index = m_nodes[index].parent)
+		{
+			index = balance(index);
+			fitToChildren(index);
+		}
+	}
+
+	//Rotates the taller grandchild subtree up when a's children differ in height by more than one.
+	//Returns the node now at a's place.
+	int DynamicBvh::balance(int a)
+	{
+		if (m_nodes[a].isLeaf() || m_nodes[a].height < 2)
+			return a;
+		int b = m_nodes[a].child[0];
+		int c = m_nodes[a].child[1];
+		int difference = m_nodes[c].height - m_nodes[b].height;
+		if (difference >= -1 && difference <= 1)
+			return a;
+
+		//up is the taller child, it takes a's place and a keeps the shorter of up's children
+		int upSide = difference > 1 ? 1 : 0;
+		int up = m_nodes[a].child[upSide];
+		int f = m_nodes[up].child[0];
+		int g = m_nodes[up].child[1];
+
+		int parent = m_nodes[a].parent;
+		m_nodes[up].child[0] = a;
+		m_nodes[up].parent = parent;
+		m_nodes[a].parent = up;
+		if (parent < 0)
+			m_root = up;
+		else
+			m_nodes[parent].child[m_nodes[parent].child[0] == a ? 0 : 1] = up;
+
+		int keep = m_nodes[f].height > m_nodes[g].height ? f : g;
+		int give = keep == f ? g : f;
+		m_nodes[up].child[1] = keep;
+		m_nodes[a].child[upSide] = give;
+		m_nodes[give].parent = a;
+		fitToChildren(a);
+		fitToChildren(up);
+		return up;
+	}
+
+	void DynamicBvh::cullFrustum(const Frustum& frustum, std::vector<int>& outVisible)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		outVisible.clear();
+		m_stats.proxyCount = m_proxyCount;
+		m_stats.nodesVisited = 0;
+		m_stats.subtreesCulled = 0;
+		m_stats.subtreesAccepted = 0;
+
+#ifdef __AVX2__
+		//One plane per lane, the two spare lanes hold a plane everything is in front of
+		alignas(32) float planeX[8], planeY[8], planeZ[8], planeD[8];
+		for (int p = 0; p < 8; p++)
+		{
+			bool real = p < FRUSTUM_PLANE_COUNT;
+			planeX[p] = real ? frustum.planes[p].normal.x : 0.0f;
+			planeY[p] = real ? frustum.planes[p].normal.y : 0.0f;
+			planeZ[p] = real ? frustum.planes[p].normal.z : 0.0f;
+			planeD[p] = real ? frustum.planes[p].distance : 1.0f;
+		}
+		__m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+		__m256 nx = _mm256_load_ps(planeX);
+		__m256 ny = _mm256_load_ps(planeY);
+		__m256 nz = _mm256_load_ps(planeZ);
+		__m256 nd = _mm256_load_ps(planeD);
+		__m256 absX = _mm256_and_ps(nx, absMask);
+		__m256 absY = _mm256_and_ps(ny, absMask);
+		__m256 absZ = _mm256_and_ps(nz, absMask);
+#endif
+		//0 outside, 1 straddling, 2 inside. Signed distance of the box center against its projected
+		//half extent on each plane normal.
+		auto classify = [&](const Node& node)
+		{
+			glm::vec3 center = (node.boxMin + node.boxMax) * 0.5f;
+			glm::vec3 extent = (node.boxMax - node.boxMin) * 0.5f;
+#ifdef __AVX2__
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, _mm256_set1_ps(center.x)), _mm256_mul_ps(ny, _mm256_set1_ps(center.y))),
+				_mm256_add_ps(_mm256_mul_ps(nz, _mm256_set1_ps(center.z)), nd));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX, _mm256_set1_ps(extent.x)), _mm256_mul_ps(absY, _mm256_set1_ps(extent.y))),
+				_mm256_mul_ps(absZ, _mm256_set1_ps(extent.z)));
+			if (_mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_sub_ps(_mm256_setzero_ps(), radius), _CMP_LT_OQ)) != 0)
+				return 0;
+			return _mm256_movemask_ps(_mm256_cmp_ps(distance, radius, _CMP_GE_OQ)) == 0xFF ? 2 : 1;
+#else
+			int result = 2;
+			for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+			{
+				const Plane& plane = frustum.planes[p];
+				float distance = glm::dot(plane.normal, center) + plane.distance;
+				float radius = glm::dot(glm::abs(plane.normal), extent);
+				if (distance < -radius)
+					return 0;
+				if (distance < radius)
+					result = 1;
+			}
+			return result;
+#endif
+		};
+
+		//Entries are node indices, negated (~node) once an ancestor was found fully inside
+		m_stack.clear();
+		if (m_root >= 0)
+			m_stack.push_back(m_root);
+		while (!m_stack.empty())
+		{
+			int entry = m_stack.back();
+			m_stack.pop_back();
+			m_stats.nodesVisited++;
+			bool accepted = entry < 0;
+			const Node& node = m_nodes[accepted ? ~entry : entry];
+			if (!accepted)
+			{
+				int result = classify(node);
+				if (result == 0)
+				{
+					if (!node.isLeaf())
+						m_stats.subtreesCulled++;
+					continue;
+				}
+				if (result == 2 && !node.isLeaf())
+				{
+					m_stats.subtreesAccepted++;
+					accepted = true;
+				}
+			}
+			if (node.isLeaf())
+			{
+				outVisible.push_back(node.userData);
+				continue;
+			}
+			m_stack.push_back(accepted ? ~node.child[0] : node.child[0]);
+			m_stack.push_back(accepted ? ~node.child[1] : node.child[1]);
+		}
+
+		m_stats.visibleCount = (int)outVisible.size();
+		m_stats.culledCount = m_proxyCount - m_stats.visibleCount;
+		auto end = std::chrono::high_resolution_clock::now();
+		m_stats.milliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+	}
+}
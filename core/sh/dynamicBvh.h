@@ -0,0 +1,81 @@
+//sh/dynamicBvh.h
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "culling.h"
+namespace sh
+{
+	struct BvhCullStats
+	{
+		int proxyCount;
+		int nodesVisited; //Tree nodes popped during the last query, leaves included
+		int subtreesCulled; //Outside the frustum, skipped with everything below them
+		int subtreesAccepted; //Inside the frustum, leaves taken without testing
+		int visibleCount;
+		int culledCount;
+		float milliseconds; //CPU time of the last query
+	};
+
+	//Dynamic AABB tree over scene instances, in the style of Box2D's b2DynamicTree.
+	//Each proxy is a leaf holding a box fattened by a margin, so objects that move a little stay
+	//inside it and update() leaves the tree alone. Leaves are inserted next to the sibling that
+	//grows the tree's surface area least, and ancestors are rebalanced with AVL style rotations on
+	//the way back up. Proxy ids are leaf indices and stay valid until the proxy is removed.
+	//For scenes where most objects move every frame, setBounds() every proxy and refit() once
+	//instead of reinserting them.
+	//Frustum queries classify a node against all six planes at once (AVX2 when core is built with
+	//it). Subtrees outside any plane are skipped, subtrees inside every plane have their leaves
+	//taken without further tests.
+	class DynamicBvh
+	{
+	public:
+		explicit DynamicBvh(float margin = 0.25f) : m_margin(margin) {}
+		//userData comes back from queries, e.g. a scene node
+		int insert(int userData, const glm::vec3& boxMin, const glm::vec3& boxMax);
+		void remove(int proxy);
+		//Reinserts the proxy if the box left its fattened box. Returns true if the tree changed.
+		bool update(int proxy, const glm::vec3& boxMin, const glm::vec3& boxMax);
+		//Replaces a leaf's box without restructuring, ancestors are stale until refit()
+		void setBounds(int proxy, const glm::vec3& boxMin, const glm::vec3& boxMax);
+		//Recomputes every internal box from its children
+		void refit();
+		void clear();
+
+		//userData of every proxy whose box touches the frustum
+		void cullFrustum(const Frustum& frustum, std::vector<int>& outVisible);
+
+		int getUserData(int proxy) const { return m_nodes[proxy].userData; }
+		int getProxyCount() const { return m_proxyCount; }
+		//Leaves are height 0, -1 when empty
+		int getHeight() const { return m_root < 0 ? -1 : m_nodes[m_root].height; }
+		const BvhCullStats& getStats() const { return m_stats; }
+	private:
+		struct Node
+		{
+			glm::vec3 boxMin;
+			glm::vec3 boxMax;
+			int parent; //Next free node while on the free list
+			int child[2]; //-1 for leaves
+			int height;
+			int userData;
+			bool isLeaf() const { return child[0] < 0; }
+		};
+		int allocateNode();
+		void freeNode(int node);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		int balance(int node);
+		//Box and height from the children
+		void fitToChildren(int node);
+
+		std::vector<Node> m_nodes;
+		int m_root = -1;
+		int m_freeList = -1;
+		int m_proxyCount = 0;
+		float m_margin;
+		std::vector<int> m_stack; //Traversal scratch
+		BvhCullStats m_stats = {};
+	};
+}
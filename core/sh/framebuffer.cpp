@@ -1,4 +1,5 @@
 #include "framebuffer.h"
+#include "gpuMemory.h"
 
 namespace sh
 {
@@ -36,10 +37,36 @@ namespace sh
 			printf("Framebuffer incomplete: %d", fboStatus);
 		}
 
+		buff.colorCount = 1;
+		buff.memoryId = trackGpuAllocation(GpuMemoryCategory::RENDER_TARGET, "Framebuffer",
+			textureBytes(GL_RGBA8, width, height) + textureBytes(GL_DEPTH_COMPONENT16, width, height));
 		return buff;
 	}
 
-	FrameBuffer createGBuffer(unsigned int width, unsigned int height)
+	GBufferFormats getGBufferFormats(GBufferLayout layout)
+	{
+		GBufferFormats formats;
+		if (layout == GBufferLayout::COMPACT)
+		{
+			//12 bytes per pixel. Depth is 32 bit float since world position is reconstructed from it.
+			formats.colorCount = 2;
+			formats.color[0] = GL_RG16_SNORM; //0 = Octahedral World Normal
+			formats.color[1] = GL_RGBA8; //1 = Albedo
+			formats.color[2] = 0;
+			formats.depth = GL_DEPTH_COMPONENT32F;
+		}
+		else
+		{
+			formats.colorCount = 3;
+			formats.color[0] = GL_RGB32F; //0 = World Position
+			formats.color[1] = GL_RGB16F; //1 = World Normal
+			formats.color[2] = GL_RGB16F; //2 = Albedo
+			formats.depth = GL_DEPTH_COMPONENT16;
+		}
+		return formats;
+	}
+
+	FrameBuffer createGBuffer(unsigned int width, unsigned int height, GBufferLayout layout)
 	{
 		FrameBuffer framebuffer;
 		framebuffer.width = width;
@@ -48,17 +75,13 @@ namespace sh
 		glCreateFramebuffers(1, &framebuffer.fbo);
 		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
 
-		int formats[3] = {
-			GL_RGB32F, //0 = World Position 
-			GL_RGB16F, //1 = World Normal
-			GL_RGB16F  //2 = Albedo
-		};
-		//Create 3 color textures
-		for (size_t i = 0; i < 3; i++)
+		GBufferFormats formats = getGBufferFormats(layout);
+		//Create the color textures
+		for (int i = 0; i < formats.colorCount; i++)
 		{
 			glGenTextures(1, &framebuffer.colorBuffer[i]);
 			glBindTexture(GL_TEXTURE_2D, framebuffer.colorBuffer[i]);
-			glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+			glTexStorage2D(GL_TEXTURE_2D, 1, formats.color[i], width, height);
 			//Clamp to border so we don't wrap when sampling for post processing
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
@@ -72,13 +95,16 @@ namespace sh
 		const GLenum drawBuffers[3] = {
 				GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2
 		};
-		glDrawBuffers(3, drawBuffers);
+		glDrawBuffers(formats.colorCount, drawBuffers);
 
 		//Add texture2D depth buffer
 		glGenTextures(1, &framebuffer.depthBuffer);
 		glBindTexture(GL_TEXTURE_2D, framebuffer.depthBuffer);
-		//Create 16 bit depth buffer - must be same width/height of color buffer
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, width, height);
+		//Create depth buffer - must be same width/height of color buffer
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats.depth, width, height);
+		//Sampled to rebuild world position in the compact layout
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		//Attach to framebuffer (assuming FBO is bound)
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, framebuffer.depthBuffer, 0);
 
@@ -88,6 +114,15 @@ namespace sh
 			printf("Framebuffer incomplete: %d", fboStatus);
 		}
 
+		framebuffer.colorCount = formats.colorCount;
+		size_t bytes = textureBytes(formats.depth, width, height);
+		for (int i = 0; i < formats.colorCount; i++)
+		{
+			bytes += textureBytes(formats.color[i], width, height);
+		}
+		framebuffer.memoryId = trackGpuAllocation(GpuMemoryCategory::RENDER_TARGET,
+			layout == GBufferLayout::COMPACT ? "GBuffer (compact)" : "GBuffer", bytes);
+
 		//Clean up global state
 		glBindTexture(GL_TEXTURE_2D, 0);
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -97,5 +132,8 @@ namespace sh
 	void sh::deleteFramebuffer(FrameBuffer buff)
 	{
 		glDeleteFramebuffers(1, &buff.fbo);
+		glDeleteTextures(buff.colorCount, buff.colorBuffer);
+		glDeleteTextures(1, &buff.depthBuffer);
+		releaseGpuAllocation(buff.memoryId);
 	}
 }
\ No newline at end of file
@@ -12,8 +12,25 @@ namespace sh
 		unsigned int depthBuffer;
 		unsigned int width;
 		unsigned int height;
+		int colorCount;
+		int memoryId; //sh::trackGpuAllocation id
 	};
+	enum class GBufferLayout
+	{
+		//World position RGB32F, normal RGB16F, albedo RGB16F, 16 bit depth
+		STANDARD = 0,
+		//No position target (rebuilt from depth), octahedral normal RG16_SNORM, albedo RGBA8, 32 bit float depth
+		COMPACT = 1
+	};
+	struct GBufferFormats
+	{
+		int colorCount;
+		int color[3];
+		int depth;
+	};
+	GBufferFormats getGBufferFormats(GBufferLayout layout);
+
 	FrameBuffer createFramebuffer(unsigned int width, unsigned int height, int colorFormat);
-	FrameBuffer createGBuffer(unsigned int width, unsigned int height);
+	FrameBuffer createGBuffer(unsigned int width, unsigned int height, GBufferLayout layout = GBufferLayout::STANDARD);
 	void deleteFramebuffer(FrameBuffer buff);
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "gpuMemory.h"
+#include <string.h>
+#include <algorithm>
+#include <imgui.h>
+
+//Not part of the core profile glad header
+#define GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX 0x9047
+#define GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#define GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#define GPU_MEMORY_INFO_EVICTION_COUNT_NVX 0x904A
+#define GPU_MEMORY_INFO_EVICTED_MEMORY_NVX 0x904B
+#define TEXTURE_FREE_MEMORY_ATI 0x87FC
+
+namespace sh
+{
+	static bool hasExtension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (extension != NULL && strcmp(extension, name) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	DriverMemoryInfo queryDriverMemory()
+	{
+		//Extension list doesn't change for the lifetime of the context
+		static int vendor = -1; //0 = none, 1 = NVX, 2 = ATI
+		if (vendor < 0)
+		{
+			vendor = hasExtension("GL_NVX_gpu_memory_info") ? 1 : hasExtension("GL_ATI_meminfo") ? 2 : 0;
+		}
+
+		DriverMemoryInfo info = {};
+		if (vendor == 1)
+		{
+			info.available = true;
+			info.source = "GL_NVX_gpu_memory_info";
+			glGetIntegerv(GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &info.dedicatedKB);
+			glGetIntegerv(GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &info.totalAvailableKB);
+			glGetIntegerv(GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &info.currentAvailableKB);
+			glGetIntegerv(GPU_MEMORY_INFO_EVICTION_COUNT_NVX, &info.evictionCount);
+			glGetIntegerv(GPU_MEMORY_INFO_EVICTED_MEMORY_NVX, &info.evictedKB);
+		}
+		else if (vendor == 2)
+		{
+			//[0] = total free, [1] = largest free block, [2..3] = auxiliary memory
+			GLint free[4] = {};
+			glGetIntegerv(TEXTURE_FREE_MEMORY_ATI, free);
+			info.available = true;
+			info.source = "GL_ATI_meminfo";
+			info.currentAvailableKB = free[0];
+		}
+		else
+		{
+			info.source = "None";
+		}
+		return info;
+	}
+
+	void drawGpuMemoryWindow()
+	{
+		const float mb = 1.0f / (1024.0f * 1024.0f);
+		ImGui::Begin("GPU Memory");
+
+		GpuMemoryStats stats = getGpuMemoryStats();
+		ImGui::Text("Tracked: %.2f MB (peak %.2f MB) in %d allocations", stats.totalBytes * mb, stats.totalPeakBytes * mb, stats.allocationCount);
+
+		DriverMemoryInfo driver = queryDriverMemory();
+		if (driver.available)
+		{
+			ImGui::Text("Driver (%s):", driver.source);
+			if (driver.dedicatedKB > 0)
+				ImGui::Text("  Dedicated %.1f MB, available %.1f MB of %.1f MB", driver.dedicatedKB / 1024.0f, driver.currentAvailableKB / 1024.0f, driver.totalAvailableKB / 1024.0f);
+			else
+				ImGui::Text("  Free texture memory %.1f MB", driver.currentAvailableKB / 1024.0f);
+			if (driver.evictionCount > 0)
+				ImGui::Text("  Evictions %d (%.1f MB)", driver.evictionCount, driver.evictedKB / 1024.0f);
+		}
+		else
+		{
+			ImGui::Text("Driver memory info not available");
+		}
+
+		if (ImGui::BeginTable("Categories", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("Category");
+			ImGui::TableSetupColumn("MB");
+			ImGui::TableSetupColumn("Peak MB");
+			ImGui::TableHeadersRow();
+			for (int i = 0; i < (int)GpuMemoryCategory::COUNT; i++)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(getGpuMemoryCategoryName((GpuMemoryCategory)i));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", stats.currentBytes[i] * mb);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", stats.peakBytes[i] * mb);
+			}
+			ImGui::EndTable();
+		}
+
+		if (ImGui::CollapsingHeader("Resources")) {
+			std::vector<GpuAllocationInfo> list = getGpuAllocations();
+			std::sort(list.begin(), list.end(), [](const GpuAllocationInfo& a, const GpuAllocationInfo& b) {
+				if (a.category != b.category)
+					return a.category < b.category;
+				return a.bytes > b.bytes;
+			});
+			if (ImGui::BeginTable("Resources", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+				ImGui::TableSetupColumn("Category");
+				ImGui::TableSetupColumn("Name");
+				ImGui::TableSetupColumn("MB");
+				ImGui::TableSetupColumn("Peak MB");
+				ImGui::TableHeadersRow();
+				for (size_t i = 0; i < list.size(); i++)
+				{
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(getGpuMemoryCategoryName(list[i].category));
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(list[i].name.c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", list[i].bytes * mb);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", list[i].peakBytes * mb);
+				}
+				ImGui::EndTable();
+			}
+		}
+		ImGui::End();
+	}
+}
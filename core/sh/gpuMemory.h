@@ -0,0 +1,37 @@
+//sh/gpuMemory.h
+#pragma once
+
+#include <stdio.h>
+#include "../ew/gpuMemory.h"
+namespace sh
+{
+	//The tracker itself is in ew, sh adds what the driver reports and a window over both
+	using ew::GpuMemoryCategory;
+	using ew::GpuMemoryStats;
+	using ew::GpuAllocationInfo;
+	using ew::getGpuMemoryCategoryName;
+	using ew::bytesPerPixel;
+	using ew::mipLevelCount;
+	using ew::textureBytes;
+	using ew::trackGpuAllocation;
+	using ew::resizeGpuAllocation;
+	using ew::releaseGpuAllocation;
+	using ew::getGpuMemoryStats;
+	using ew::getGpuAllocations;
+
+	//What the driver reports through GL_NVX_gpu_memory_info or GL_ATI_meminfo, in kilobytes
+	struct DriverMemoryInfo
+	{
+		bool available;
+		const char* source;
+		int dedicatedKB; //NVX only
+		int totalAvailableKB; //NVX only
+		int currentAvailableKB;
+		int evictionCount; //NVX only
+		int evictedKB; //NVX only
+	};
+
+	DriverMemoryInfo queryDriverMemory();
+	//ImGui window with totals, peaks and a per-resource table
+	void drawGpuMemoryWindow();
+}
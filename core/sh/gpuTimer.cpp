@@ -0,0 +1,130 @@
+#include "gpuTimer.h"
+#include <imgui.h>
+
+namespace sh
+{
+	void GpuTimer::begin(const std::string& name)
+	{
+		if (m_active >= 0)
+		{
+			printf("GpuTimer: %s started while %s is still running\n", name.c_str(), m_scopes[m_active].name.c_str());
+			return;
+		}
+
+		int index = -1;
+		for (size_t i = 0; i < m_scopes.size(); i++)
+		{
+			if (m_scopes[i].name == name)
+			{
+				index = (int)i;
+				break;
+			}
+		}
+		if (index < 0)
+		{
+			Scope scope;
+			scope.name = name;
+			glGenQueries(QUERY_FRAMES, scope.queries);
+			for (int i = 0; i < QUERY_FRAMES; i++)
+			{
+				scope.pending[i] = false;
+			}
+			scope.milliseconds = 0.0f;
+			m_scopes.push_back(scope);
+			index = (int)m_scopes.size() - 1;
+		}
+
+		Scope& scope = m_scopes[index];
+		int slot = m_frame % QUERY_FRAMES;
+		//Only happens if the GPU is more than QUERY_FRAMES behind
+		if (scope.pending[slot])
+			readResult(scope, slot);
+		glBeginQuery(GL_TIME_ELAPSED, scope.queries[slot]);
+		scope.pending[slot] = true;
+		scope.lastFrame = m_frame;
+		m_active = index;
+	}
+
+	void GpuTimer::end()
+	{
+		if (m_active < 0)
+			return;
+		glEndQuery(GL_TIME_ELAPSED);
+		m_active = -1;
+	}
+
+	void GpuTimer::readResult(Scope& scope, int slot)
+	{
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(scope.queries[slot], GL_QUERY_RESULT, &nanoseconds);
+		float milliseconds = (float)(nanoseconds / 1.0e6);
+		scope.milliseconds = scope.milliseconds == 0.0f ? milliseconds : scope.milliseconds * 0.9f + milliseconds * 0.1f;
+		scope.pending[slot] = false;
+	}
+
+	void GpuTimer::endFrame()
+	{
+		for (size_t i = 0; i < m_scopes.size(); i++)
+		{
+			Scope& scope = m_scopes[i];
+			for (int slot = 0; slot < QUERY_FRAMES; slot++)
+			{
+				if (!scope.pending[slot] || (m_active == (int)i && slot == (int)(m_frame % QUERY_FRAMES)))
+					continue;
+				GLint available = 0;
+				glGetQueryObjectiv(scope.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+				if (available)
+					readResult(scope, slot);
+			}
+		}
+		m_frame++;
+	}
+
+	float GpuTimer::getMilliseconds(const std::string& name) const
+	{
+		for (size_t i = 0; i < m_scopes.size(); i++)
+		{
+			if (m_scopes[i].name == name)
+				return m_scopes[i].milliseconds;
+		}
+		return -1.0f;
+	}
+
+	void GpuTimer::drawTable() const
+	{
+		if (ImGui::BeginTable("GPU Timings", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("Scope");
+			ImGui::TableSetupColumn("ms");
+			ImGui::TableHeadersRow();
+			float total = 0.0f;
+			for (size_t i = 0; i < m_scopes.size(); i++)
+			{
+				//Skip scopes that were turned off
+				if (m_scopes[i].lastFrame + QUERY_FRAMES < m_frame)
+					continue;
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(m_scopes[i].name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", m_scopes[i].milliseconds);
+				total += m_scopes[i].milliseconds;
+			}
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted("Total");
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", total);
+			ImGui::EndTable();
+		}
+	}
+
+	void GpuTimer::destroy()
+	{
+		for (size_t i = 0; i < m_scopes.size(); i++)
+		{
+			glDeleteQueries(QUERY_FRAMES, m_scopes[i].queries);
+		}
+		m_scopes.clear();
+		m_active = -1;
+	}
+}
@@ -0,0 +1,45 @@
+//sh/gpuTimer.h
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "../ew/external/glad.h"
+namespace sh
+{
+	//Named GPU timings from GL_TIME_ELAPSED queries. Each scope keeps a small ring of queries so
+	//results are read a few frames late instead of stalling on the GPU.
+	//Scopes can't nest, only one GL_TIME_ELAPSED query can be active at a time.
+	class GpuTimer
+	{
+	public:
+		void begin(const std::string& name);
+		void end();
+		//Call once per frame after the last scope. Collects every result that is ready.
+		void endFrame();
+		int getScopeCount() const { return (int)m_scopes.size(); }
+		const std::string& getScopeName(int scope) const { return m_scopes[scope].name; }
+		//Smoothed over recent frames
+		float getMilliseconds(int scope) const { return m_scopes[scope].milliseconds; }
+		//-1 if no scope has that name
+		float getMilliseconds(const std::string& name) const;
+		//ImGui table of scopes used in the last few frames
+		void drawTable() const;
+		void destroy();
+	private:
+		static const int QUERY_FRAMES = 4;
+		struct Scope
+		{
+			std::string name;
+			unsigned int queries[QUERY_FRAMES];
+			bool pending[QUERY_FRAMES];
+			float milliseconds;
+			unsigned int lastFrame;
+		};
+		void readResult(Scope& scope, int slot);
+
+		std::vector<Scope> m_scopes;
+		int m_active = -1;
+		unsigned int m_frame = 0;
+	};
+}
@@ -0,0 +1,219 @@
+#include "lightManager.h"
+#include <algorithm>
+#include <chrono>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace sh
+{
+	//Spreads the low 10 bits of v out to every third bit
+	static uint32_t expandBits(uint32_t v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	static uint32_t mortonCode(const glm::vec3& normalized)
+	{
+		glm::uvec3 q = glm::uvec3(glm::clamp(normalized * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f)));
+		return (expandBits(q.x) << 2) | (expandBits(q.y) << 1) | expandBits(q.z);
+	}
+
+	//The grid is refined until the average occupied cell holds at most this many lights
+	static const int MAX_LIGHTS_PER_CELL = 64;
+
+	void LightManager::setLights(const glm::vec3* positions, const float* radii, int count, float padding)
+	{
+		m_x.clear();
+		m_y.clear();
+		m_z.clear();
+		m_radius.clear();
+		m_index.clear();
+		m_cells.clear();
+		m_stats = {};
+		if (count <= 0)
+			return;
+
+		glm::vec3 boundsMin = positions[0], boundsMax = positions[0];
+		for (int i = 1; i < count; i++)
+		{
+			boundsMin = glm::min(boundsMin, positions[i]);
+			boundsMax = glm::max(boundsMax, positions[i]);
+		}
+		glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-4f));
+
+		std::vector<std::pair<uint32_t, uint32_t>> codes(count);
+		for (int i = 0; i < count; i++)
+		{
+			codes[i] = std::make_pair(mortonCode((positions[i] - boundsMin) / extent), (uint32_t)i);
+		}
+		std::sort(codes.begin(), codes.end());
+
+		m_x.resize(count);
+		m_y.resize(count);
+		m_z.resize(count);
+		m_radius.resize(count);
+		m_index.resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			uint32_t original = codes[i].second;
+			m_x[i] = positions[original].x;
+			m_y[i] = positions[original].y;
+			m_z[i] = positions[original].z;
+			m_radius[i] = radii[original] + padding;
+			m_index[i] = original;
+		}
+
+		//Each level splits every axis in two, but lights that all share a plane or cluster together only
+		//occupy some of the new cells, so count the occupied ones instead of assuming 8x per level
+		auto occupiedCells = [&](int shift) {
+			int cells = 1;
+			for (int i = 1; i < count; i++)
+			{
+				if ((codes[i].first >> shift) != (codes[i - 1].first >> shift))
+					cells++;
+			}
+			return cells;
+		};
+		int level = 0;
+		while (level < 10 && count > MAX_LIGHTS_PER_CELL * occupiedCells(3 * (10 - level)))
+			level++;
+		int shift = 3 * (10 - level);
+		for (int i = 0; i < count; i++)
+		{
+			uint32_t cellCode = codes[i].first >> shift;
+			glm::vec3 p = glm::vec3(m_x[i], m_y[i], m_z[i]);
+			glm::vec3 r = glm::vec3(m_radius[i]);
+			if (m_cells.empty() || (codes[m_cells.back().first].first >> shift) != cellCode)
+			{
+				Cell cell;
+				cell.first = (uint32_t)i;
+				cell.count = 0;
+				cell.boundsMin = p - r;
+				cell.boundsMax = p + r;
+				m_cells.push_back(cell);
+			}
+			Cell& cell = m_cells.back();
+			cell.count++;
+			cell.boundsMin = glm::min(cell.boundsMin, p - r);
+			cell.boundsMax = glm::max(cell.boundsMax, p + r);
+		}
+		m_stats.lightCount = count;
+		m_stats.cellCount = (int)m_cells.size();
+	}
+
+	void LightManager::testRange(const Frustum& frustum, uint32_t first, uint32_t count, std::vector<uint32_t>& outVisible) const
+	{
+		uint32_t end = first + count;
+		uint32_t i = first;
+#ifdef __AVX2__
+		__m256 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], nd[FRUSTUM_PLANE_COUNT];
+		for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+		{
+			nx[p] = _mm256_set1_ps(frustum.planes[p].normal.x);
+			ny[p] = _mm256_set1_ps(frustum.planes[p].normal.y);
+			nz[p] = _mm256_set1_ps(frustum.planes[p].normal.z);
+			nd[p] = _mm256_set1_ps(frustum.planes[p].distance);
+		}
+		//Cells start anywhere in the arrays, so unaligned loads
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(&m_x[i]);
+			__m256 y = _mm256_loadu_ps(&m_y[i]);
+			__m256 z = _mm256_loadu_ps(&m_z[i]);
+			__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&m_radius[i]));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+			{
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+					_mm256_add_ps(_mm256_mul_ps(nz[p], z), nd[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negRadius, _CMP_GE_OQ));
+			}
+			int mask = _mm256_movemask_ps(inside);
+			for (int bit = 0; mask != 0; bit++, mask >>= 1)
+			{
+				if (mask & 1)
+					outVisible.push_back(m_index[i + bit]);
+			}
+		}
+#endif
+		for (; i < end; i++)
+		{
+			BoundingSphere sphere = { glm::vec3(m_x[i], m_y[i], m_z[i]), m_radius[i] };
+			if (sphereInFrustum(frustum, sphere))
+				outVisible.push_back(m_index[i]);
+		}
+	}
+
+	void LightManager::cullFrustum(const Frustum& frustum, std::vector<uint32_t>& outVisible)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		outVisible.clear();
+		m_stats.cellsCulled = 0;
+		m_stats.cellsAccepted = 0;
+		m_stats.lightsTested = 0;
+		for (size_t c = 0; c < m_cells.size(); c++)
+		{
+			const Cell& cell = m_cells[c];
+			//Classify the cell: outside any plane culls it, inside every plane accepts it whole
+			bool outside = false;
+			bool inside = true;
+			for (int p = 0; p < FRUSTUM_PLANE_COUNT && !outside; p++)
+			{
+				const Plane& plane = frustum.planes[p];
+				glm::vec3 positive = glm::vec3(
+					plane.normal.x >= 0.0f ? cell.boundsMax.x : cell.boundsMin.x,
+					plane.normal.y >= 0.0f ? cell.boundsMax.y : cell.boundsMin.y,
+					plane.normal.z >= 0.0f ? cell.boundsMax.z : cell.boundsMin.z);
+				glm::vec3 negative = glm::vec3(
+					plane.normal.x >= 0.0f ? cell.boundsMin.x : cell.boundsMax.x,
+					plane.normal.y >= 0.0f ? cell.boundsMin.y : cell.boundsMax.y,
+					plane.normal.z >= 0.0f ? cell.boundsMin.z : cell.boundsMax.z);
+				if (glm::dot(plane.normal, positive) + plane.distance < 0.0f)
+					outside = true;
+				else if (glm::dot(plane.normal, negative) + plane.distance < 0.0f)
+					inside = false;
+			}
+			if (outside)
+			{
+				m_stats.cellsCulled++;
+				continue;
+			}
+			if (inside)
+			{
+				m_stats.cellsAccepted++;
+				outVisible.insert(outVisible.end(), m_index.begin() + cell.first, m_index.begin() + cell.first + cell.count);
+				continue;
+			}
+			m_stats.lightsTested += cell.count;
+			testRange(frustum, cell.first, cell.count, outVisible);
+		}
+		m_stats.visibleCount = (int)outVisible.size();
+		auto end = std::chrono::high_resolution_clock::now();
+		m_stats.milliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+	}
+
+	void LightManager::queryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& outLights) const
+	{
+		outLights.clear();
+		for (size_t c = 0; c < m_cells.size(); c++)
+		{
+			const Cell& cell = m_cells[c];
+			glm::vec3 closest = glm::clamp(center, cell.boundsMin, cell.boundsMax);
+			glm::vec3 toClosest = closest - center;
+			if (glm::dot(toClosest, toClosest) > radius * radius)
+				continue;
+			for (uint32_t i = cell.first; i < cell.first + cell.count; i++)
+			{
+				glm::vec3 d = glm::vec3(m_x[i], m_y[i], m_z[i]) - center;
+				float reach = m_radius[i] + radius;
+				if (glm::dot(d, d) <= reach * reach)
+					outLights.push_back(m_index[i]);
+			}
+		}
+	}
+}
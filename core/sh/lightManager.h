@@ -0,0 +1,56 @@
+//sh/lightManager.h
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "culling.h"
+namespace sh
+{
+	struct LightCullStats
+	{
+		int lightCount;
+		int cellCount; //Non-empty grid cells
+		int cellsCulled; //Entirely outside the frustum
+		int cellsAccepted; //Entirely inside, lights taken without testing
+		int lightsTested; //Went through the per light sphere test
+		int visibleCount;
+		float milliseconds; //CPU time of the last cull
+	};
+
+	//CPU side spatial index over point lights for culling before anything reaches the GPU.
+	//Lights are stored as SoA arrays sorted by the Morton code of their position, so every cell of
+	//a power of two grid over the light bounds is one contiguous range. Culling tests each non-empty
+	//cell's bounds first, takes fully inside cells whole, and runs the lights of straddling cells
+	//through an 8 wide sphere test (AVX2 when core is built with it). The visible list comes out in
+	//Morton order since the arrays already are.
+	class LightManager
+	{
+	public:
+		//Rebuilds the index. padding is added to every radius, for lights that move around their position.
+		void setLights(const glm::vec3* positions, const float* radii, int count, float padding = 0.0f);
+		//Indices into the original arrays of lights that can touch the frustum, in Morton order
+		void cullFrustum(const Frustum& frustum, std::vector<uint32_t>& outVisible);
+		//Indices of lights whose sphere touches the query sphere
+		void queryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& outLights) const;
+
+		int getLightCount() const { return (int)m_index.size(); }
+		const LightCullStats& getStats() const { return m_stats; }
+	private:
+		struct Cell
+		{
+			uint32_t first; //Range in the sorted arrays
+			uint32_t count;
+			glm::vec3 boundsMin; //Around the light spheres, not the cell
+			glm::vec3 boundsMax;
+		};
+		void testRange(const Frustum& frustum, uint32_t first, uint32_t count, std::vector<uint32_t>& outVisible) const;
+
+		//SoA, Morton sorted
+		std::vector<float> m_x, m_y, m_z, m_radius;
+		std::vector<uint32_t> m_index; //Sorted position -> original index
+		std::vector<Cell> m_cells;
+		LightCullStats m_stats = {};
+	};
+}
@@ -0,0 +1,186 @@
+#include "pointShadowAtlas.h"
+#include "shadowbuffer.h"
+#include "gpuMemory.h"
+#include <algorithm>
+
+namespace sh
+{
+	void PointShadowAtlas::create(unsigned int resolution, int slotCount)
+	{
+		m_resolution = resolution;
+		m_slots.assign(slotCount, Slot());
+		m_changes.clear();
+		m_stats = {};
+		m_frame = 0;
+
+		glCreateTextures(GL_TEXTURE_CUBE_MAP_ARRAY, 1, &m_texture);
+		glTextureStorage3D(m_texture, 1, GL_DEPTH_COMPONENT16, resolution, resolution, slotCount * CUBE_FACES);
+		setShadowSampling(m_texture, ShadowMode::DEPTH_COMPARE);
+		//Faces are looked up by direction, so seams between faces are filtered across
+		glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		float farDepth = 1.0f;
+		glClearTexImage(m_texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+
+		m_memoryId = trackGpuAllocation(GpuMemoryCategory::SHADOW_MAP, "Point Shadow Atlas",
+			textureBytes(GL_DEPTH_COMPONENT16, resolution, resolution, slotCount * CUBE_FACES));
+	}
+
+	void PointShadowAtlas::destroy()
+	{
+		glDeleteTextures(1, &m_texture);
+		releaseGpuAllocation(m_memoryId);
+		m_texture = 0;
+		m_memoryId = -1;
+		m_slots.clear();
+		m_changes.clear();
+	}
+
+	void PointShadowAtlas::reset()
+	{
+		m_slots.assign(m_slots.size(), Slot());
+		m_changes.clear();
+	}
+
+	void PointShadowAtlas::invalidate()
+	{
+		for (Slot& slot : m_slots)
+		{
+			slot.dirtyFaces = ALL_CUBE_FACES;
+		}
+	}
+
+	void PointShadowAtlas::schedule(const std::vector<ShadowCandidate>& candidates, int faceBudget, std::vector<ShadowFaceUpdate>& outUpdates)
+	{
+		m_changes.clear();
+		outUpdates.clear();
+		m_stats = {};
+		m_frame++;
+
+		//The slot count highest priority candidates get a slot
+		std::vector<ShadowCandidate> wanted;
+		for (const ShadowCandidate& candidate : candidates)
+		{
+			if (candidate.priority > 0.0f)
+				wanted.push_back(candidate);
+		}
+		size_t keep = std::min(wanted.size(), m_slots.size());
+		std::partial_sort(wanted.begin(), wanted.begin() + keep, wanted.end(),
+			[](const ShadowCandidate& a, const ShadowCandidate& b) { return a.priority > b.priority; });
+		wanted.resize(keep);
+
+		//Lights that are still wanted keep their slot and cached faces, the rest are evicted
+		std::vector<bool> resident(wanted.size(), false);
+		for (Slot& slot : m_slots)
+		{
+			if (slot.light < 0)
+				continue;
+			int found = -1;
+			for (size_t i = 0; i < wanted.size(); i++)
+			{
+				if (wanted[i].light == slot.light)
+				{
+					found = (int)i;
+					break;
+				}
+			}
+			if (found < 0)
+			{
+				if (slot.ready)
+					m_changes.push_back({ slot.light, -1 });
+				slot = Slot();
+				m_stats.evictions++;
+				continue;
+			}
+			resident[found] = true;
+			//Faces drawn while it was moving are from wherever it was at the time
+			if (wanted[found].isStatic && !slot.isStatic)
+				slot.dirtyFaces = ALL_CUBE_FACES;
+			slot.isStatic = wanted[found].isStatic;
+			slot.priority = wanted[found].priority;
+		}
+		size_t nextFree = 0;
+		for (size_t i = 0; i < wanted.size(); i++)
+		{
+			if (resident[i])
+				continue;
+			while (m_slots[nextFree].light >= 0)
+				nextFree++;
+			Slot& slot = m_slots[nextFree];
+			slot.light = wanted[i].light;
+			slot.priority = wanted[i].priority;
+			slot.isStatic = wanted[i].isStatic;
+		}
+
+		//Faces that need drawing, most urgent first: never drawn, dirty, then moving lights by age.
+		//Static faces that are neither are reused as they are.
+		struct FaceTask
+		{
+			int slot;
+			int face;
+			int group;
+			float order; //Lower first within a group
+		};
+		std::vector<FaceTask> tasks;
+		for (int s = 0; s < (int)m_slots.size(); s++)
+		{
+			const Slot& slot = m_slots[s];
+			if (slot.light < 0)
+				continue;
+			for (int face = 0; face < CUBE_FACES; face++)
+			{
+				int bit = 1 << face;
+				if (!(slot.renderedFaces & bit))
+				{
+					tasks.push_back({ s, face, 0, -slot.priority });
+					m_stats.facesMissing++;
+				}
+				else if (slot.dirtyFaces & bit)
+					tasks.push_back({ s, face, 1, -slot.priority });
+				else if (!slot.isStatic)
+					tasks.push_back({ s, face, 2, (float)slot.faceFrame[face] });
+			}
+		}
+		std::sort(tasks.begin(), tasks.end(), [](const FaceTask& a, const FaceTask& b)
+		{
+			if (a.group != b.group)
+				return a.group < b.group;
+			if (a.order != b.order)
+				return a.order < b.order;
+			if (a.slot != b.slot)
+				return a.slot < b.slot;
+			return a.face < b.face;
+		});
+		if ((int)tasks.size() > faceBudget)
+			tasks.resize(std::max(faceBudget, 0));
+
+		//One update per slot so each light is drawn in a single layered pass
+		std::vector<int> faceMasks(m_slots.size(), 0);
+		for (const FaceTask& task : tasks)
+		{
+			faceMasks[task.slot] |= 1 << task.face;
+			Slot& slot = m_slots[task.slot];
+			slot.renderedFaces |= 1 << task.face;
+			slot.dirtyFaces &= ~(1 << task.face);
+			slot.faceFrame[task.face] = m_frame;
+		}
+		m_stats.facesRendered = (int)tasks.size();
+		for (int s = 0; s < (int)m_slots.size(); s++)
+		{
+			Slot& slot = m_slots[s];
+			if (faceMasks[s])
+				outUpdates.push_back({ slot.light, s, faceMasks[s] });
+			if (slot.light < 0)
+				continue;
+			m_stats.residentLights++;
+			//Goes live in the frame its last face is drawn, the caller renders updates before lighting
+			if (!slot.ready && slot.renderedFaces == ALL_CUBE_FACES)
+			{
+				slot.ready = true;
+				m_changes.push_back({ slot.light, s });
+			}
+			if (slot.ready)
+				m_stats.readyLights++;
+		}
+	}
+}
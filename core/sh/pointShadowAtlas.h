@@ -0,0 +1,94 @@
+//sh/pointShadowAtlas.h
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../ew/external/glad.h"
+namespace sh
+{
+	const int CUBE_FACES = 6;
+	const int ALL_CUBE_FACES = (1 << CUBE_FACES) - 1;
+
+	//A light that could be given a shadow slot this frame
+	struct ShadowCandidate
+	{
+		int light; //Index into the caller's light list
+		float priority; //Higher wins a slot, e.g. how much of the screen the light covers
+		bool isStatic; //Its cached faces stay correct while casters don't move
+	};
+
+	//Faces of one light to render this frame. Drawn as one layered pass into layers
+	//slot * CUBE_FACES + face for every bit set in faceMask.
+	struct ShadowFaceUpdate
+	{
+		int light;
+		int slot;
+		int faceMask;
+	};
+
+	//A light gaining or losing its shadow. slot is -1 when the light no longer has one.
+	//Lights are only given out once all six faces have been rendered, so lighting never reads
+	//faces left over from the slot's previous owner.
+	struct ShadowSlotChange
+	{
+		int light;
+		int slot;
+	};
+
+	struct PointShadowStats
+	{
+		int residentLights; //Lights holding a slot
+		int readyLights; //Of those, the ones with every face rendered
+		int facesRendered; //This frame
+		int facesMissing; //Faces of resident lights that have never been rendered
+		int evictions; //This frame
+	};
+
+	//Cube shadow maps for a budgeted number of point lights, stored as the slots of one
+	//GL_TEXTURE_CUBE_MAP_ARRAY. Faces store distance to the light divided by its radius, which
+	//lighting compares against through a samplerCubeArrayShadow.
+	//schedule() is the per frame scheduler: it hands slots to the highest priority candidates and
+	//picks at most faceBudget faces to render, so the cost per frame is fixed no matter how many
+	//lights are shadowed. New lights get their faces first, then dirty faces, then faces of moving
+	//lights, oldest first. Clean faces of static lights are never redrawn.
+	class PointShadowAtlas
+	{
+	public:
+		void create(unsigned int resolution, int slotCount);
+		void destroy();
+		//Forgets every resident light without reporting changes, for when light indices are reassigned
+		void reset();
+		//Every face is redrawn before anything else, e.g. after static casters moved
+		void invalidate();
+		void schedule(const std::vector<ShadowCandidate>& candidates, int faceBudget, std::vector<ShadowFaceUpdate>& outUpdates);
+		//Changes made by the last schedule(), for keeping a GPU side light -> slot table in sync
+		const std::vector<ShadowSlotChange>& getSlotChanges() const { return m_changes; }
+
+		unsigned int getTexture() const { return m_texture; }
+		unsigned int getResolution() const { return m_resolution; }
+		int getSlotCount() const { return (int)m_slots.size(); }
+		//Layer count of the texture, slot count times six
+		int getLayerCount() const { return (int)m_slots.size() * CUBE_FACES; }
+		const PointShadowStats& getStats() const { return m_stats; }
+	private:
+		struct Slot
+		{
+			int light = -1;
+			float priority = 0.0f;
+			bool isStatic = false;
+			bool ready = false; //Light has been handed out through a ShadowSlotChange
+			int renderedFaces = 0; //Faces drawn at least once since the light moved in
+			int dirtyFaces = 0; //Faces that must be redrawn before they're reused
+			unsigned int faceFrame[CUBE_FACES] = {}; //Frame each face was last drawn
+		};
+
+		unsigned int m_texture = 0;
+		unsigned int m_resolution = 0;
+		int m_memoryId = -1;
+		unsigned int m_frame = 0;
+		std::vector<Slot> m_slots;
+		std::vector<ShadowSlotChange> m_changes;
+		PointShadowStats m_stats = {};
+	};
+}
@@ -0,0 +1,537 @@
+#include "renderGraph.h"
+#include "gpuMemory.h"
+#include <algorithm>
+
+namespace sh
+{
+	bool isDepthFormat(int internalFormat)
+	{
+		switch (internalFormat) {
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	//Integer formats have to be cleared through GL_RGBA_INTEGER, 0 if not integer, otherwise GL_INT or GL_UNSIGNED_INT
+	static int integerFormatType(int internalFormat)
+	{
+		switch (internalFormat) {
+		case GL_R8UI:
+		case GL_R16UI:
+		case GL_R32UI:
+		case GL_RG8UI:
+		case GL_RG16UI:
+		case GL_RG32UI:
+		case GL_RGB8UI:
+		case GL_RGB16UI:
+		case GL_RGB32UI:
+		case GL_RGBA8UI:
+		case GL_RGBA16UI:
+		case GL_RGBA32UI:
+		case GL_RGB10_A2UI:
+			return GL_UNSIGNED_INT;
+		case GL_R8I:
+		case GL_R16I:
+		case GL_R32I:
+		case GL_RG8I:
+		case GL_RG16I:
+		case GL_RG32I:
+		case GL_RGB8I:
+		case GL_RGB16I:
+		case GL_RGB32I:
+		case GL_RGBA8I:
+		case GL_RGBA16I:
+		case GL_RGBA32I:
+			return GL_INT;
+		default:
+			return 0;
+		}
+	}
+
+	//glClearTexImage with the format and type the texture's internal format accepts.
+	//Stencil is cleared to 0, integer formats get the color converted.
+	static void clearTexture(unsigned int texture, int internalFormat, const glm::vec4& color, float depth)
+	{
+		if (internalFormat == GL_DEPTH24_STENCIL8)
+		{
+			GLuint packed = (GLuint)(glm::clamp(depth, 0.0f, 1.0f) * 16777215.0f + 0.5f) << 8;
+			glClearTexImage(texture, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, &packed);
+		}
+		else if (internalFormat == GL_DEPTH32F_STENCIL8)
+		{
+			struct { float depth; GLuint stencil; } packed = { depth, 0 };
+			glClearTexImage(texture, 0, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, &packed);
+		}
+		else if (isDepthFormat(internalFormat))
+		{
+			glClearTexImage(texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+		}
+		else if (integerFormatType(internalFormat) == GL_UNSIGNED_INT)
+		{
+			glm::uvec4 value = glm::uvec4(glm::max(color, glm::vec4(0.0f)));
+			glClearTexImage(texture, 0, GL_RGBA_INTEGER, GL_UNSIGNED_INT, &value.x);
+		}
+		else if (integerFormatType(internalFormat) == GL_INT)
+		{
+			glm::ivec4 value = glm::ivec4(color);
+			glClearTexImage(texture, 0, GL_RGBA_INTEGER, GL_INT, &value.x);
+		}
+		else
+		{
+			glClearTexImage(texture, 0, GL_RGBA, GL_FLOAT, &color.x);
+		}
+	}
+
+	ResourceHandle RenderGraph::createTexture(const std::string& name, const TextureDesc& desc)
+	{
+		VirtualResource resource;
+		resource.name = name;
+		resource.desc = desc;
+		m_resources.push_back(resource);
+		m_compiled = false;
+		return (ResourceHandle)m_resources.size() - 1;
+	}
+
+	ResourceHandle RenderGraph::createPersistentTexture(const std::string& name, const TextureDesc& desc)
+	{
+		ResourceHandle handle = createTexture(name, desc);
+		m_resources[handle].persistent = true;
+		m_resources[handle].output = true;
+		return handle;
+	}
+
+	ResourceHandle RenderGraph::importTexture(const std::string& name, unsigned int texture, unsigned int width, unsigned int height, int internalFormat)
+	{
+		VirtualResource resource;
+		resource.name = name;
+		resource.desc.internalFormat = internalFormat;
+		resource.imported = true;
+		resource.importedTexture = texture;
+		resource.importedWidth = width;
+		resource.importedHeight = height;
+		m_resources.push_back(resource);
+		m_compiled = false;
+		return (ResourceHandle)m_resources.size() - 1;
+	}
+
+	ResourceHandle RenderGraph::importBackbuffer()
+	{
+		VirtualResource resource;
+		resource.name = "Backbuffer";
+		resource.imported = true;
+		resource.backbuffer = true;
+		resource.output = true;
+		m_resources.push_back(resource);
+		m_compiled = false;
+		return (ResourceHandle)m_resources.size() - 1;
+	}
+
+	void RenderGraph::markOutput(ResourceHandle resource)
+	{
+		m_resources[resource].output = true;
+		m_compiled = false;
+	}
+
+	int RenderGraph::addPass(const PassDesc& desc)
+	{
+		Pass pass;
+		pass.desc = desc;
+		m_passes.push_back(pass);
+		m_compiled = false;
+		return (int)m_passes.size() - 1;
+	}
+
+	void RenderGraph::setSize(unsigned int width, unsigned int height)
+	{
+		if (width == 0 || height == 0)
+			return;
+		if (width == m_width && height == m_height)
+			return;
+		m_width = width;
+		m_height = height;
+		m_compiled = false;
+	}
+
+	glm::uvec2 RenderGraph::resolveSize(const VirtualResource& resource) const
+	{
+		if (resource.backbuffer)
+			return glm::uvec2(m_width, m_height);
+		if (resource.imported)
+			return glm::uvec2(resource.importedWidth, resource.importedHeight);
+		if (resource.desc.width != 0 && resource.desc.height != 0)
+			return glm::uvec2(resource.desc.width, resource.desc.height);
+		unsigned int w = (unsigned int)(m_width * resource.desc.scale);
+		unsigned int h = (unsigned int)(m_height * resource.desc.scale);
+		return glm::uvec2(w > 0 ? w : 1, h > 0 ? h : 1);
+	}
+
+	void RenderGraph::compile()
+	{
+		releaseGPUResources();
+
+		//CULL - walk backwards from the outputs, keeping passes that write something still needed
+		std::vector<bool> needed(m_resources.size(), false);
+		for (size_t i = 0; i < m_resources.size(); i++)
+		{
+			needed[i] = m_resources[i].output;
+		}
+		for (int p = (int)m_passes.size() - 1; p >= 0; p--)
+		{
+			Pass& pass = m_passes[p];
+			std::vector<Attachment> writes = pass.desc.colorWrites;
+			if (pass.desc.depthWrite.resource != INVALID_RESOURCE)
+				writes.push_back(pass.desc.depthWrite);
+			writes.insert(writes.end(), pass.desc.storageWrites.begin(), pass.desc.storageWrites.end());
+
+			bool live = pass.desc.hasSideEffects;
+			for (size_t i = 0; i < writes.size(); i++)
+			{
+				if (needed[writes[i].resource])
+					live = true;
+			}
+			pass.live = live;
+			if (!live)
+				continue;
+
+			//A pass that clears or overwrites a target makes earlier writes to it irrelevant
+			for (size_t i = 0; i < writes.size(); i++)
+			{
+				needed[writes[i].resource] = writes[i].load == LoadOp::LOAD;
+			}
+			for (size_t i = 0; i < pass.desc.reads.size(); i++)
+			{
+				needed[pass.desc.reads[i]] = true;
+			}
+		}
+
+		//LIFETIMES - first and last live pass touching each resource
+		for (size_t i = 0; i < m_resources.size(); i++)
+		{
+			m_resources[i].firstPass = -1;
+			m_resources[i].lastPass = -1;
+			m_resources[i].physical = -1;
+		}
+		auto touch = [&](ResourceHandle r, int p) {
+			VirtualResource& resource = m_resources[r];
+			if (resource.firstPass < 0)
+				resource.firstPass = p;
+			resource.lastPass = p;
+		};
+		for (int p = 0; p < (int)m_passes.size(); p++)
+		{
+			const Pass& pass = m_passes[p];
+			if (!pass.live)
+				continue;
+			for (size_t i = 0; i < pass.desc.reads.size(); i++)
+				touch(pass.desc.reads[i], p);
+			for (size_t i = 0; i < pass.desc.colorWrites.size(); i++)
+				touch(pass.desc.colorWrites[i].resource, p);
+			if (pass.desc.depthWrite.resource != INVALID_RESOURCE)
+				touch(pass.desc.depthWrite.resource, p);
+			for (size_t i = 0; i < pass.desc.storageWrites.size(); i++)
+				touch(pass.desc.storageWrites[i].resource, p);
+		}
+
+		//ALLOCATE - transient targets share a pooled texture when their lifetimes don't overlap
+		std::vector<int> order;
+		for (size_t i = 0; i < m_resources.size(); i++)
+		{
+			VirtualResource& resource = m_resources[i];
+			if (resource.imported || resource.firstPass < 0)
+				continue;
+			//Outputs are read after the graph runs (UI, next frame), so keep them to the end
+			if (resource.output)
+				resource.lastPass = (int)m_passes.size();
+			order.push_back((int)i);
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b) {
+			return m_resources[a].firstPass < m_resources[b].firstPass;
+		});
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			VirtualResource& resource = m_resources[order[i]];
+			glm::uvec2 size = resolveSize(resource);
+			int found = -1;
+			//Anything sharing a persistent target would overwrite its history
+			for (size_t j = 0; j < m_physical.size() && !resource.persistent; j++)
+			{
+				const PhysicalTexture& phys = m_physical[j];
+				if (phys.internalFormat == resource.desc.internalFormat && phys.width == size.x && phys.height == size.y
+					&& phys.samples == resource.desc.samples && phys.lastPass < resource.firstPass)
+				{
+					found = (int)j;
+					break;
+				}
+			}
+			if (found < 0)
+			{
+				PhysicalTexture phys;
+				phys.internalFormat = resource.desc.internalFormat;
+				phys.width = size.x;
+				phys.height = size.y;
+				phys.samples = resource.desc.samples;
+				if (phys.samples > 1)
+				{
+					//Multisample textures have no sampler state
+					glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &phys.texture);
+					glTextureStorage2DMultisample(phys.texture, phys.samples, phys.internalFormat, size.x, size.y, GL_TRUE);
+				}
+				else
+				{
+					glCreateTextures(GL_TEXTURE_2D, 1, &phys.texture);
+					glTextureStorage2D(phys.texture, 1, phys.internalFormat, size.x, size.y);
+					//Clamp so screen-space effects don't wrap, nearest since these are sampled 1:1
+					glTextureParameteri(phys.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+					glTextureParameteri(phys.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+					glTextureParameteri(phys.texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+					glTextureParameteri(phys.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				}
+				//Named after the first resource placed in it, later ones alias the same memory
+				phys.memoryId = trackGpuAllocation(GpuMemoryCategory::RENDER_TARGET, "Graph: " + resource.name,
+					textureBytes(phys.internalFormat, size.x, size.y, 1, 1, phys.samples));
+				if (resource.persistent)
+				{
+					clearTexture(phys.texture, phys.internalFormat, glm::vec4(0.0f), 0.0f);
+				}
+				m_physical.push_back(phys);
+				found = (int)m_physical.size() - 1;
+			}
+			m_physical[found].lastPass = resource.lastPass;
+			resource.physical = found;
+		}
+
+		//FRAMEBUFFERS - one per distinct attachment set, shared between passes
+		for (size_t p = 0; p < m_passes.size(); p++)
+		{
+			Pass& pass = m_passes[p];
+			pass.fbo = 0;
+			pass.width = m_width;
+			pass.height = m_height;
+			if (!pass.live)
+				continue;
+			const PassDesc& desc = pass.desc;
+			ResourceHandle first = desc.colorWrites.empty() ? desc.depthWrite.resource : desc.colorWrites[0].resource;
+			if (first == INVALID_RESOURCE)
+				continue;
+			glm::uvec2 size = resolveSize(m_resources[first]);
+			pass.width = size.x;
+			pass.height = size.y;
+			pass.fbo = getFramebuffer(pass);
+		}
+
+		m_compiled = true;
+	}
+
+	unsigned int RenderGraph::getFramebuffer(const Pass& pass)
+	{
+		const PassDesc& desc = pass.desc;
+		if (!desc.colorWrites.empty() && m_resources[desc.colorWrites[0].resource].backbuffer)
+			return 0;
+
+		Framebuffer wanted;
+		for (size_t i = 0; i < desc.colorWrites.size(); i++)
+		{
+			wanted.colors.push_back(getTexture(desc.colorWrites[i].resource));
+		}
+		wanted.depth = desc.depthWrite.resource != INVALID_RESOURCE ? getTexture(desc.depthWrite.resource) : 0;
+
+		for (size_t i = 0; i < m_framebuffers.size(); i++)
+		{
+			if (m_framebuffers[i].colors == wanted.colors && m_framebuffers[i].depth == wanted.depth)
+				return m_framebuffers[i].fbo;
+		}
+
+		glCreateFramebuffers(1, &wanted.fbo);
+		GLenum drawBuffers[8];
+		for (size_t i = 0; i < wanted.colors.size() && i < 8; i++)
+		{
+			glNamedFramebufferTexture(wanted.fbo, GL_COLOR_ATTACHMENT0 + (GLenum)i, wanted.colors[i], 0);
+			drawBuffers[i] = GL_COLOR_ATTACHMENT0 + (GLenum)i;
+		}
+		if (wanted.colors.empty())
+		{
+			glNamedFramebufferDrawBuffer(wanted.fbo, GL_NONE);
+			glNamedFramebufferReadBuffer(wanted.fbo, GL_NONE);
+		}
+		else
+		{
+			glNamedFramebufferDrawBuffers(wanted.fbo, (GLsizei)wanted.colors.size(), drawBuffers);
+		}
+		if (wanted.depth != 0)
+		{
+			glNamedFramebufferTexture(wanted.fbo, GL_DEPTH_ATTACHMENT, wanted.depth, 0);
+		}
+
+		GLenum fboStatus = glCheckNamedFramebufferStatus(wanted.fbo, GL_FRAMEBUFFER);
+		if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Render graph framebuffer for pass %s incomplete: %d", desc.name.c_str(), fboStatus);
+		}
+		m_framebuffers.push_back(wanted);
+		return wanted.fbo;
+	}
+
+	void RenderGraph::execute()
+	{
+		if (!m_compiled)
+			compile();
+
+		unsigned int boundFbo = 0xFFFFFFFF;
+		glm::uvec2 viewport(0);
+		for (size_t p = 0; p < m_passes.size(); p++)
+		{
+			const Pass& pass = m_passes[p];
+			if (!pass.live)
+				continue;
+			const PassDesc& desc = pass.desc;
+			//Includes the pass's clears
+			if (m_timer)
+				m_timer->begin(desc.name);
+
+			bool hasTargets = !desc.colorWrites.empty() || desc.depthWrite.resource != INVALID_RESOURCE;
+			if (hasTargets)
+			{
+				if (pass.fbo != boundFbo)
+				{
+					glBindFramebuffer(GL_FRAMEBUFFER, pass.fbo);
+					boundFbo = pass.fbo;
+				}
+				if (viewport != glm::uvec2(pass.width, pass.height))
+				{
+					glViewport(0, 0, pass.width, pass.height);
+					viewport = glm::uvec2(pass.width, pass.height);
+				}
+
+				//Clear what was asked for, and tell the driver it can drop contents nobody will read
+				GLenum discard[9];
+				int discardCount = 0;
+				bool defaultFbo = pass.fbo == 0;
+				const Attachment& depth = desc.depthWrite;
+				bool clearDepth = depth.resource != INVALID_RESOURCE && depth.load == LoadOp::CLEAR;
+				bool clearColor = false;
+				for (size_t i = 0; i < desc.colorWrites.size(); i++)
+					clearColor |= desc.colorWrites[i].load == LoadOp::CLEAR;
+
+				//Clears obey the scissor test and write masks, which hold whatever the previous pass left.
+				//They're opened up for the clears only and restored afterwards.
+				GLboolean scissor = GL_FALSE;
+				GLboolean depthMask = GL_TRUE;
+				GLboolean colorMasks[8][4];
+				if (clearDepth || clearColor)
+				{
+					scissor = glIsEnabled(GL_SCISSOR_TEST);
+					glDisable(GL_SCISSOR_TEST);
+				}
+				for (size_t i = 0; i < desc.colorWrites.size(); i++)
+				{
+					const Attachment& attachment = desc.colorWrites[i];
+					if (attachment.load == LoadOp::CLEAR)
+					{
+						glGetBooleani_v(GL_COLOR_WRITEMASK, (GLuint)i, colorMasks[i]);
+						glColorMaski((GLuint)i, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+						int integerType = integerFormatType(m_resources[attachment.resource].desc.internalFormat);
+						if (integerType == GL_UNSIGNED_INT)
+						{
+							glm::uvec4 value = glm::uvec4(glm::max(attachment.clearColor, glm::vec4(0.0f)));
+							glClearNamedFramebufferuiv(pass.fbo, GL_COLOR, (GLint)i, &value.x);
+						}
+						else if (integerType == GL_INT)
+						{
+							glm::ivec4 value = glm::ivec4(attachment.clearColor);
+							glClearNamedFramebufferiv(pass.fbo, GL_COLOR, (GLint)i, &value.x);
+						}
+						else
+						{
+							glClearNamedFramebufferfv(pass.fbo, GL_COLOR, (GLint)i, &attachment.clearColor.x);
+						}
+						glColorMaski((GLuint)i, colorMasks[i][0], colorMasks[i][1], colorMasks[i][2], colorMasks[i][3]);
+					}
+					else if (attachment.load == LoadOp::DONT_CARE)
+					{
+						discard[discardCount++] = defaultFbo ? GL_COLOR : GL_COLOR_ATTACHMENT0 + (GLenum)i;
+					}
+				}
+				if (clearDepth)
+				{
+					glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+					glDepthMask(GL_TRUE);
+					glClearNamedFramebufferfv(pass.fbo, GL_DEPTH, 0, &depth.clearDepth);
+					glDepthMask(depthMask);
+				}
+				else if (depth.resource != INVALID_RESOURCE && depth.load == LoadOp::DONT_CARE)
+				{
+					discard[discardCount++] = defaultFbo ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+				}
+				if (scissor)
+					glEnable(GL_SCISSOR_TEST);
+				if (discardCount > 0)
+					glInvalidateNamedFramebufferData(pass.fbo, discardCount, discard);
+			}
+
+			for (size_t i = 0; i < desc.storageWrites.size(); i++)
+			{
+				const Attachment& storage = desc.storageWrites[i];
+				if (storage.load != LoadOp::CLEAR)
+					continue;
+				clearTexture(getTexture(storage.resource), m_resources[storage.resource].desc.internalFormat, storage.clearColor, storage.clearDepth);
+			}
+
+			if (desc.execute)
+				desc.execute(*this);
+			//Image stores aren't coherent with later sampling or attachment use without a barrier
+			if (!desc.storageWrites.empty())
+				glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+			if (m_timer)
+				m_timer->end();
+		}
+	}
+
+	unsigned int RenderGraph::getTexture(ResourceHandle resource) const
+	{
+		const VirtualResource& r = m_resources[resource];
+		if (r.imported)
+			return r.importedTexture;
+		if (r.physical < 0)
+			return 0;
+		return m_physical[r.physical].texture;
+	}
+
+	unsigned int RenderGraph::getWidth(ResourceHandle resource) const
+	{
+		return resolveSize(m_resources[resource]).x;
+	}
+
+	unsigned int RenderGraph::getHeight(ResourceHandle resource) const
+	{
+		return resolveSize(m_resources[resource]).y;
+	}
+
+	void RenderGraph::releaseGPUResources()
+	{
+		for (size_t i = 0; i < m_framebuffers.size(); i++)
+		{
+			glDeleteFramebuffers(1, &m_framebuffers[i].fbo);
+		}
+		m_framebuffers.clear();
+		for (size_t i = 0; i < m_physical.size(); i++)
+		{
+			glDeleteTextures(1, &m_physical[i].texture);
+			releaseGpuAllocation(m_physical[i].memoryId);
+		}
+		m_physical.clear();
+		m_compiled = false;
+	}
+
+	void RenderGraph::reset()
+	{
+		releaseGPUResources();
+		m_resources.clear();
+		m_passes.clear();
+	}
+}
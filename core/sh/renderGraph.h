@@ -0,0 +1,152 @@
+//sh/renderGraph.h
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+#include "../ew/external/glad.h"
+#include "gpuTimer.h"
+namespace sh
+{
+	typedef int ResourceHandle;
+	const ResourceHandle INVALID_RESOURCE = -1;
+
+	struct TextureDesc
+	{
+		int internalFormat = GL_RGBA8;
+		//Fixed size in pixels. When left at 0 the size follows the graph's screen size times scale.
+		unsigned int width = 0;
+		unsigned int height = 0;
+		float scale = 1.0f;
+		//Above 1 the texture is GL_TEXTURE_2D_MULTISAMPLE. It can be attached or read with
+		//sampler2DMS, and is resolved by blitting into a single sample target.
+		int samples = 1;
+	};
+
+	enum class LoadOp
+	{
+		LOAD = 0, //Keep what a previous pass wrote
+		CLEAR = 1,
+		DONT_CARE = 2 //Pass overwrites every pixel, previous contents can be discarded
+	};
+
+	struct Attachment
+	{
+		ResourceHandle resource = INVALID_RESOURCE;
+		LoadOp load = LoadOp::LOAD;
+		glm::vec4 clearColor = glm::vec4(0.0f);
+		float clearDepth = 1.0f;
+	};
+
+	class RenderGraph;
+	struct PassDesc
+	{
+		std::string name;
+		std::vector<ResourceHandle> reads; //Textures sampled by the pass
+		std::vector<Attachment> colorWrites; //Bound as color attachments in this order
+		Attachment depthWrite; //Bound as the depth attachment
+		//Written through image load/store (compute) rather than attached. CLEAR clears the whole
+		//texture first. The graph puts a memory barrier after the pass so later passes see the writes.
+		std::vector<Attachment> storageWrites;
+		bool hasSideEffects = false; //Never culled, even if nothing reads what it writes
+		std::function<void(const RenderGraph&)> execute;
+	};
+
+	//Passes declare what they read and write. compile() culls passes that don't contribute to an output,
+	//allocates transient targets from a pool (targets whose lifetimes don't overlap share a texture)
+	//and builds one framebuffer per distinct attachment set. execute() runs the live passes, binding
+	//framebuffers and applying clears only when they change. setSize() reallocates everything sized
+	//to the screen.
+	//Clears ignore the scissor test and write masks, and leave them as the previous pass set them.
+	//Passes are expected to restore any state they change, the graph doesn't reset it between passes.
+	class RenderGraph
+	{
+	public:
+		ResourceHandle createTexture(const std::string& name, const TextureDesc& desc);
+		//Keeps its contents from one execute() to the next, for history a pass reads back next frame.
+		//Never shares memory with another target, counts as an output, and is cleared to zero
+		//whenever it is (re)allocated by compile() or a resize.
+		ResourceHandle createPersistentTexture(const std::string& name, const TextureDesc& desc);
+		ResourceHandle importTexture(const std::string& name, unsigned int texture, unsigned int width, unsigned int height, int internalFormat);
+		//The default framebuffer. Writing it makes a pass an output.
+		ResourceHandle importBackbuffer();
+		//Keeps passes writing this resource alive even if no pass reads it
+		void markOutput(ResourceHandle resource);
+		int addPass(const PassDesc& pass);
+
+		void setSize(unsigned int width, unsigned int height);
+		void compile();
+		void execute();
+		//Removes all passes and resources and frees every pooled target
+		void reset();
+		//Times every live pass under its name. Pass nullptr to stop timing.
+		void setTimer(GpuTimer* timer) { m_timer = timer; }
+
+		unsigned int getTexture(ResourceHandle resource) const;
+		unsigned int getWidth(ResourceHandle resource) const;
+		unsigned int getHeight(ResourceHandle resource) const;
+		unsigned int getPassFramebuffer(int pass) const { return m_passes[pass].fbo; }
+		bool isPassLive(int pass) const { return m_passes[pass].live; }
+		int getPassCount() const { return (int)m_passes.size(); }
+		const std::string& getPassName(int pass) const { return m_passes[pass].desc.name; }
+		int getPhysicalTextureCount() const { return (int)m_physical.size(); }
+		int getResourceCount() const { return (int)m_resources.size(); }
+	private:
+		struct VirtualResource
+		{
+			std::string name;
+			TextureDesc desc;
+			bool imported = false;
+			bool backbuffer = false;
+			bool output = false;
+			bool persistent = false;
+			unsigned int importedTexture = 0;
+			unsigned int importedWidth = 0;
+			unsigned int importedHeight = 0;
+			int physical = -1;
+			int firstPass = -1;
+			int lastPass = -1;
+		};
+		struct PhysicalTexture
+		{
+			unsigned int texture;
+			int internalFormat;
+			unsigned int width;
+			unsigned int height;
+			int samples;
+			int lastPass; //Last pass using it in the current schedule, -1 once free
+			int memoryId; //sh::trackGpuAllocation id
+		};
+		struct Pass
+		{
+			PassDesc desc;
+			bool live = false;
+			unsigned int fbo = 0;
+			unsigned int width = 0;
+			unsigned int height = 0;
+		};
+		struct Framebuffer
+		{
+			unsigned int fbo;
+			std::vector<unsigned int> colors;
+			unsigned int depth;
+		};
+
+		void releaseGPUResources();
+		unsigned int getFramebuffer(const Pass& pass);
+		glm::uvec2 resolveSize(const VirtualResource& resource) const;
+
+		std::vector<VirtualResource> m_resources;
+		std::vector<Pass> m_passes;
+		std::vector<PhysicalTexture> m_physical;
+		std::vector<Framebuffer> m_framebuffers;
+		unsigned int m_width = 1;
+		unsigned int m_height = 1;
+		bool m_compiled = false;
+		GpuTimer* m_timer = nullptr;
+	};
+
+	bool isDepthFormat(int internalFormat);
+}
@@ -0,0 +1,110 @@
+#include "shadowCache.h"
+
+namespace sh
+{
+	static glm::ivec4 unionRect(const glm::ivec4& a, const glm::ivec4& b)
+	{
+		if (a.z <= 0 || a.w <= 0)
+			return b;
+		if (b.z <= 0 || b.w <= 0)
+			return a;
+		glm::ivec2 lo = glm::min(glm::ivec2(a.x, a.y), glm::ivec2(b.x, b.y));
+		glm::ivec2 hi = glm::max(glm::ivec2(a.x + a.z, a.y + a.w), glm::ivec2(b.x + b.z, b.y + b.w));
+		return glm::ivec4(lo, hi - lo);
+	}
+
+	void ShadowCache::create(unsigned int width, unsigned int height, ShadowMode mode)
+	{
+		m_live = createShadowBuffer(width, height, mode);
+		m_static = createShadowBuffer(width, height);
+		m_staticValid = false;
+		m_dynamicRect = glm::ivec4(0);
+		m_lastDynamicRect = glm::ivec4(0);
+		m_stats.totalTexels = (int)(width * height);
+	}
+
+	void ShadowCache::destroy()
+	{
+		deleteShadowBuffer(m_live);
+		deleteShadowBuffer(m_static);
+		m_staticValid = false;
+	}
+
+	bool ShadowCache::beginStatic(const glm::mat4& lightViewProj)
+	{
+		m_stats.staticRedrawn = false;
+		m_stats.restoredTexels = 0;
+		m_stats.dynamicTexels = 0;
+		if (m_staticValid && lightViewProj == m_lightViewProj)
+			return false;
+
+		m_lightViewProj = lightViewProj;
+		glBindFramebuffer(GL_FRAMEBUFFER, m_static.fbo);
+		glViewport(0, 0, m_static.width, m_static.height);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		return true;
+	}
+
+	void ShadowCache::endStatic()
+	{
+		//Whole map changed, so every texel gets restored and there is nothing stale left over
+		copyRect(glm::ivec4(0, 0, m_live.width, m_live.height));
+		m_lastDynamicRect = glm::ivec4(0);
+		m_staticValid = true;
+		m_stats.staticRedrawn = true;
+	}
+
+	void ShadowCache::addDynamicBounds(const glm::vec3& worldMin, const glm::vec3& worldMax)
+	{
+		glm::vec2 lo = glm::vec2(1.0f);
+		glm::vec2 hi = glm::vec2(-1.0f);
+		for (int i = 0; i < 8; i++)
+		{
+			glm::vec3 corner = glm::vec3((i & 1) ? worldMax.x : worldMin.x, (i & 2) ? worldMax.y : worldMin.y, (i & 4) ? worldMax.z : worldMin.z);
+			glm::vec4 clip = m_lightViewProj * glm::vec4(corner, 1.0f);
+			glm::vec2 ndc = glm::vec2(clip) / clip.w;
+			lo = glm::min(lo, ndc);
+			hi = glm::max(hi, ndc);
+		}
+		glm::vec2 size = glm::vec2(m_live.width, m_live.height);
+		//One texel of padding for rasterization at the edges
+		glm::ivec2 texelLo = glm::ivec2(glm::floor((lo * 0.5f + 0.5f) * size)) - 1;
+		glm::ivec2 texelHi = glm::ivec2(glm::ceil((hi * 0.5f + 0.5f) * size)) + 1;
+		texelLo = glm::clamp(texelLo, glm::ivec2(0), glm::ivec2(size));
+		texelHi = glm::clamp(texelHi, glm::ivec2(0), glm::ivec2(size));
+		if (texelHi.x <= texelLo.x || texelHi.y <= texelLo.y)
+			return;
+		m_dynamicRect = unionRect(m_dynamicRect, glm::ivec4(texelLo, texelHi - texelLo));
+	}
+
+	void ShadowCache::copyRect(const glm::ivec4& rect)
+	{
+		if (rect.z <= 0 || rect.w <= 0)
+			return;
+		glCopyImageSubData(m_static.shadowMap, GL_TEXTURE_2D, 0, rect.x, rect.y, 0,
+			m_live.shadowMap, GL_TEXTURE_2D, 0, rect.x, rect.y, 0, rect.z, rect.w, 1);
+		m_stats.restoredTexels += rect.z * rect.w;
+	}
+
+	bool ShadowCache::beginDynamic()
+	{
+		//Wipe where dynamic casters were last frame as well as where they are going
+		copyRect(unionRect(m_lastDynamicRect, m_dynamicRect));
+		m_lastDynamicRect = m_dynamicRect;
+		m_stats.dynamicTexels = m_dynamicRect.z * m_dynamicRect.w;
+		if (m_dynamicRect.z <= 0 || m_dynamicRect.w <= 0)
+			return false;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_live.fbo);
+		glViewport(0, 0, m_live.width, m_live.height);
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(m_dynamicRect.x, m_dynamicRect.y, m_dynamicRect.z, m_dynamicRect.w);
+		return true;
+	}
+
+	void ShadowCache::endDynamic()
+	{
+		glDisable(GL_SCISSOR_TEST);
+		m_dynamicRect = glm::ivec4(0);
+	}
+}
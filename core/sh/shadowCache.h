@@ -0,0 +1,60 @@
+//sh/shadowCache.h
+#pragma once
+
+#include <stdio.h>
+#include <glm/glm.hpp>
+#include "../ew/external/glad.h"
+#include "shadowbuffer.h"
+namespace sh
+{
+	struct ShadowCacheStats
+	{
+		bool staticRedrawn; //Static casters were drawn this frame
+		int restoredTexels; //Copied back from the static map this frame
+		int dynamicTexels; //Inside this frame's dynamic scissor
+		int totalTexels;
+	};
+
+	//Static casters are drawn once into a persistent map and only redrawn when the light moves or
+	//invalidate() is called. Each frame the region dynamic casters covered last frame and will cover
+	//this frame is copied back from the static map, then only the dynamic casters are drawn, scissored
+	//to their light space bounds.
+	//Usage per frame:
+	//	if (cache.beginStatic(lightViewProj)) { draw static casters; cache.endStatic(); }
+	//	cache.addDynamicBounds(...) for each dynamic caster
+	//	if (cache.beginDynamic()) { draw dynamic casters; } cache.endDynamic();
+	class ShadowCache
+	{
+	public:
+		//mode applies to the sampled map, the static map is only ever copied from
+		void create(unsigned int width, unsigned int height, ShadowMode mode = ShadowMode::DEPTH);
+		void destroy();
+		//Forces the static casters to be redrawn next frame
+		void invalidate() { m_staticValid = false; }
+		//Returns true if the static casters need drawing, with the static map bound and cleared
+		bool beginStatic(const glm::mat4& lightViewProj);
+		void endStatic();
+		void addDynamicBounds(const glm::vec3& worldMin, const glm::vec3& worldMax);
+		//Restores the dirty region and binds the shadow map scissored to this frame's dynamic bounds.
+		//Returns false if no dynamic caster lands in the map.
+		bool beginDynamic();
+		void endDynamic();
+
+		unsigned int getShadowMap() const { return m_live.shadowMap; }
+		unsigned int getWidth() const { return m_live.width; }
+		unsigned int getHeight() const { return m_live.height; }
+		const glm::mat4& getLightViewProj() const { return m_lightViewProj; }
+		ShadowCacheStats getStats() const { return m_stats; }
+	private:
+		void copyRect(const glm::ivec4& rect);
+
+		ShadowBuffer m_live; //Sampled by lighting
+		ShadowBuffer m_static; //Static casters only
+		glm::mat4 m_lightViewProj = glm::mat4(0.0f);
+		bool m_staticValid = false;
+		//x, y, width, height in texels. Zero width means empty.
+		glm::ivec4 m_dynamicRect = glm::ivec4(0);
+		glm::ivec4 m_lastDynamicRect = glm::ivec4(0);
+		ShadowCacheStats m_stats = {};
+	};
+}
@@ -0,0 +1,128 @@
+#include "shadowFit.h"
+#include <math.h>
+#include <float.h>
+
+namespace sh
+{
+	//Grows min/max by points transformed into light space
+	static void expandLightBounds(const glm::mat4& lightView, const glm::vec3* points, int count, glm::vec3& outMin, glm::vec3& outMax)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			glm::vec3 p = glm::vec3(lightView * glm::vec4(points[i], 1.0f));
+			outMin = glm::min(outMin, p);
+			outMax = glm::max(outMax, p);
+		}
+	}
+
+	static bool isEmpty(const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		return boxMin.x > boxMax.x || boxMin.y > boxMax.y || boxMin.z > boxMax.z;
+	}
+
+	static void boxCorners(const glm::vec3& boxMin, const glm::vec3& boxMax, glm::vec3* outCorners)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			outCorners[i] = glm::vec3((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+		}
+	}
+
+	ShadowFit fitLightFrustum(const ew::Camera& camera, const glm::vec3& toLight,
+		const glm::vec3& sceneMin, const glm::vec3& sceneMax, float shadowDistance, unsigned int resolution)
+	{
+		ShadowFit fit;
+		glm::vec3 lightDir = glm::normalize(toLight);
+		glm::vec3 up = fabsf(lightDir.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+		//Rotation only, the translation is folded into the projection once the bounds are known.
+		//Light space looks down -z, so larger z is closer to the light.
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -lightDir, up);
+
+		//Camera frustum out to the shadow distance
+		float farDistance = glm::min(shadowDistance, camera.farPlane);
+		glm::mat4 invView = glm::inverse(camera.viewMatrix());
+		float tanY = tanf(glm::radians(camera.fov) * 0.5f);
+		float tanX = tanY * camera.aspectRatio;
+		glm::vec3 viewFrustum[8];
+		glm::vec3 frustum[8];
+		glm::vec3 frustumMin = glm::vec3(FLT_MAX), frustumMax = glm::vec3(-FLT_MAX);
+		for (int i = 0; i < 8; i++)
+		{
+			float z = (i & 4) ? farDistance : camera.nearPlane;
+			float x = ((i & 1) ? 1.0f : -1.0f) * tanX * z;
+			float y = ((i & 2) ? 1.0f : -1.0f) * tanY * z;
+			viewFrustum[i] = glm::vec3(x, y, -z);
+			frustum[i] = glm::vec3(invView * glm::vec4(viewFrustum[i], 1.0f));
+			frustumMin = glm::min(frustumMin, frustum[i]);
+			frustumMax = glm::max(frustumMax, frustum[i]);
+		}
+
+		//Receivers: each of these bounds is conservative, so their intersection is as well
+		glm::vec3 scene[8];
+		boxCorners(sceneMin, sceneMax, scene);
+		glm::vec3 sceneLightMin = glm::vec3(FLT_MAX), sceneLightMax = glm::vec3(-FLT_MAX);
+		expandLightBounds(lightView, scene, 8, sceneLightMin, sceneLightMax);
+
+		glm::vec3 frustumLightMin = glm::vec3(FLT_MAX), frustumLightMax = glm::vec3(-FLT_MAX);
+		expandLightBounds(lightView, frustum, 8, frustumLightMin, frustumLightMax);
+
+		glm::vec3 overlapMin = glm::max(frustumMin, sceneMin);
+		glm::vec3 overlapMax = glm::min(frustumMax, sceneMax);
+		if (isEmpty(overlapMin, overlapMax))
+		{
+			fit.valid = false;
+			overlapMin = sceneMin;
+			overlapMax = sceneMax;
+		}
+		else
+		{
+			fit.valid = true;
+		}
+		glm::vec3 overlap[8];
+		boxCorners(overlapMin, overlapMax, overlap);
+		glm::vec3 overlapLightMin = glm::vec3(FLT_MAX), overlapLightMax = glm::vec3(-FLT_MAX);
+		expandLightBounds(lightView, overlap, 8, overlapLightMin, overlapLightMax);
+
+		glm::vec3 receiverMin = glm::max(glm::max(frustumLightMin, sceneLightMin), overlapLightMin);
+		glm::vec3 receiverMax = glm::min(glm::min(frustumLightMax, sceneLightMax), overlapLightMax);
+		if (!fit.valid || isEmpty(receiverMin, receiverMax))
+		{
+			fit.valid = false;
+			receiverMin = sceneLightMin;
+			receiverMax = sceneLightMax;
+		}
+
+		//Quantize the size to 1/64th of the frustum slice's bounding sphere so it only changes in steps,
+		//then snap the corner to whole texels of that size. Together they keep texels fixed in world space.
+		//The sphere only depends on the projection and shadow distance, unlike the scene bounds, which
+		//change whenever something in the scene moves or rotates. It's measured in view space so
+		//camera movement doesn't even change it by rounding.
+		//The extra step covers the snap, which moves the corner by at most a texel.
+		glm::vec3 frustumCenter = glm::vec3(0.0f);
+		for (int i = 0; i < 8; i++)
+			frustumCenter += viewFrustum[i] / 8.0f;
+		float frustumRadius = 0.0f;
+		for (int i = 0; i < 8; i++)
+			frustumRadius = glm::max(frustumRadius, glm::length(viewFrustum[i] - frustumCenter));
+		glm::vec2 step = glm::vec2(glm::max(2.0f * frustumRadius / 64.0f, 1e-4f));
+		glm::vec2 extent = (glm::ceil(glm::vec2(receiverMax - receiverMin) / step) + 1.0f) * step;
+		fit.texelWorldSize = extent / (float)resolution;
+		glm::vec2 lo = glm::floor(glm::vec2(receiverMin) / fit.texelWorldSize) * fit.texelWorldSize;
+		glm::vec2 hi = lo + extent;
+
+		//Depth: from the closest scene geometry toward the light down to the farthest receiver.
+		//Casters outside the receiver rectangle can't shadow anything inside it, so the scene
+		//bounds toward the light are enough.
+		float casterTop = sceneLightMax.z;
+		float receiverBottom = receiverMin.z;
+		//A little slack so geometry exactly on the bounds isn't clipped
+		float slack = glm::max((casterTop - receiverBottom) * 0.01f, 1e-3f);
+		fit.nearPlane = -(casterTop + slack);
+		fit.farPlane = -(receiverBottom - slack);
+
+		fit.view = lightView;
+		fit.projection = glm::ortho(lo.x, hi.x, lo.y, hi.y, fit.nearPlane, fit.farPlane);
+		fit.viewProj = fit.projection * fit.view;
+		return fit;
+	}
+}
@@ -0,0 +1,28 @@
+//sh/shadowFit.h
+#pragma once
+
+#include <stdio.h>
+#include <glm/glm.hpp>
+#include "../ew/camera.h"
+namespace sh
+{
+	struct ShadowFit
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProj;
+		glm::vec2 texelWorldSize; //Width and height of one shadow map texel in world units
+		float nearPlane; //Light space depth range actually used
+		float farPlane;
+		bool valid; //False if the camera doesn't see any of the scene bounds
+	};
+
+	//Fits an orthographic light projection to what needs shadowing this frame.
+	//Receivers are the part of the scene bounds inside the camera frustum (out to shadowDistance),
+	//casters are anything in the scene bounds between them and the light. The rectangle is grown to
+	//a stable size and snapped to whole texels so it doesn't shimmer as the camera moves, and
+	//near/far are fitted to the caster/receiver depth range for the most depth precision.
+	//toLight points from the scene toward the light.
+	ShadowFit fitLightFrustum(const ew::Camera& camera, const glm::vec3& toLight,
+		const glm::vec3& sceneMin, const glm::vec3& sceneMax, float shadowDistance, unsigned int resolution);
+}
@@ -1,14 +1,82 @@
 #include "shadowbuffer.h"
+#include "gpuMemory.h"
+#include <math.h>
 
 namespace sh
 {
-	ShadowBuffer sh::createShadowBuffer(unsigned int width, unsigned int height)
+	//Work group width of momentBlur.comp
+	static const int MOMENT_BLUR_GROUP_SIZE = 64;
+
+	void setShadowSampling(unsigned int texture, ShadowMode mode)
+	{
+		if (mode == ShadowMode::DEPTH_COMPARE)
+		{
+			//Each lookup compares against 4 texels and bilinearly filters the results
+			glTextureParameteri(texture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTextureParameteri(texture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+			glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+		else
+		{
+			glTextureParameteri(texture, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+			glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+	}
+
+	bool isMomentShadowMode(ShadowMode mode)
+	{
+		return mode == ShadowMode::VSM || mode == ShadowMode::EVSM;
+	}
+
+	//Moments of a texel at the far plane, used for clearing and as the border color
+	static void farPlaneMoments(ShadowMode mode, float* out)
+	{
+		if (mode == ShadowMode::EVSM)
+		{
+			float positive = expf(EVSM_POSITIVE_EXPONENT);
+			float negative = -expf(-EVSM_NEGATIVE_EXPONENT);
+			out[0] = positive;
+			out[1] = positive * positive;
+			out[2] = negative;
+			out[3] = negative * negative;
+		}
+		else
+		{
+			out[0] = 1.0f;
+			out[1] = 1.0f;
+			out[2] = 0.0f;
+			out[3] = 0.0f;
+		}
+	}
+
+	static unsigned int createMomentTexture(ShadowMode mode, unsigned int width, unsigned int height, int levels)
+	{
+		GLenum format = mode == ShadowMode::EVSM ? GL_RGBA16F : GL_RG32F;
+		unsigned int texture;
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, levels, format, width, height);
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		float borderColor[4];
+		farPlaneMoments(mode, borderColor);
+		glTextureParameterfv(texture, GL_TEXTURE_BORDER_COLOR, borderColor);
+		return texture;
+	}
+
+	ShadowBuffer sh::createShadowBuffer(unsigned int width, unsigned int height, ShadowMode mode)
 	{
 		ShadowBuffer buff;
 
 		//add in given easy values
 		buff.width = width;
 		buff.height = height;
+		buff.mode = mode;
+		buff.moments = 0;
+		buff.momentsTemp = 0;
 
 		glCreateFramebuffers(1, &buff.fbo);
 		glBindFramebuffer(GL_FRAMEBUFFER, buff.fbo);
@@ -18,8 +86,7 @@ namespace sh
 
 		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, width, height);
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		setShadowSampling(buff.shadowMap, mode);
 		//Pixels outside of frustum should have max distance (white)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
@@ -27,14 +94,92 @@ namespace sh
 		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, buff.shadowMap, 0);
-		glDrawBuffer(GL_NONE);
+
+		size_t bytes = textureBytes(GL_DEPTH_COMPONENT16, width, height);
+		if (isMomentShadowMode(mode))
+		{
+			//Depth is still needed for depth testing, the moments are what gets filtered and sampled
+			int levels = mipLevelCount(width, height);
+			GLenum format = mode == ShadowMode::EVSM ? GL_RGBA16F : GL_RG32F;
+			buff.moments = createMomentTexture(mode, width, height, levels);
+			buff.momentsTemp = createMomentTexture(mode, width, height, 1);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buff.moments, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			bytes += textureBytes(format, width, height, 1, levels) + textureBytes(format, width, height);
+		}
+		else
+		{
+			glDrawBuffer(GL_NONE);
+		}
 		glReadBuffer(GL_NONE);
 
+		GLenum fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Shadow framebuffer incomplete: %d", fboStatus);
+		}
+
+		buff.memoryId = trackGpuAllocation(GpuMemoryCategory::SHADOW_MAP, "Shadow Map", bytes);
 		return buff;
 	}
 
+	void beginShadowPass(const ShadowBuffer& buff)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, buff.fbo);
+		glViewport(0, 0, buff.width, buff.height);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		if (isMomentShadowMode(buff.mode))
+		{
+			float clearMoments[4];
+			farPlaneMoments(buff.mode, clearMoments);
+			glClearBufferfv(GL_COLOR, 0, clearMoments);
+		}
+	}
+
+	void prefilterShadowMoments(const ShadowBuffer& buff, const ew::Shader& blurShader, int radius)
+	{
+		if (!isMomentShadowMode(buff.mode))
+			return;
+
+		if (radius > 0)
+		{
+			GLenum format = buff.mode == ShadowMode::EVSM ? GL_RGBA16F : GL_RG32F;
+			blurShader.use();
+			blurShader.setInt("_Source", 0);
+			blurShader.setInt("_Radius", radius);
+
+			//Horizontal: moments -> momentsTemp. Each work group covers a run of one row.
+			glBindTextureUnit(0, buff.moments);
+			glBindImageTexture(0, buff.momentsTemp, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+			blurShader.setInt("_Horizontal", 1);
+			blurShader.dispatch((buff.width + MOMENT_BLUR_GROUP_SIZE - 1) / MOMENT_BLUR_GROUP_SIZE, buff.height);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			//Vertical: momentsTemp -> moments level 0
+			glBindTextureUnit(0, buff.momentsTemp);
+			glBindImageTexture(0, buff.moments, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+			blurShader.setInt("_Horizontal", 0);
+			blurShader.dispatch((buff.height + MOMENT_BLUR_GROUP_SIZE - 1) / MOMENT_BLUR_GROUP_SIZE, buff.width);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+			glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+		}
+		//Mips keep distant and grazing lookups filtered instead of aliasing
+		glGenerateTextureMipmap(buff.moments);
+	}
+
+	unsigned int getShadowSampleTexture(const ShadowBuffer& buff)
+	{
+		return isMomentShadowMode(buff.mode) ? buff.moments : buff.shadowMap;
+	}
+
 	void sh::deleteShadowBuffer(ShadowBuffer buff)
 	{
 		glDeleteFramebuffers(1, &buff.fbo);
+		glDeleteTextures(1, &buff.shadowMap);
+		if (buff.moments)
+			glDeleteTextures(1, &buff.moments);
+		if (buff.momentsTemp)
+			glDeleteTextures(1, &buff.momentsTemp);
+		releaseGpuAllocation(buff.memoryId);
 	}
 }
@@ -3,15 +3,42 @@
 
 #include <stdio.h>
 #include "../ew/external/glad.h"
+#include "../ew/shader.h"
 namespace sh
 {
+	enum class ShadowMode
+	{
+		DEPTH = 0, //Raw depth with nearest filtering, sampled through sampler2D
+		DEPTH_COMPARE = 1, //Hardware depth comparison with linear filtering, sampled through sampler2DShadow
+		VSM = 2, //Depth and depth squared in a mipmapped RG32F color target, see prefilterShadowMoments
+		EVSM = 3 //Positive and negative exponential moments in a mipmapped RGBA16F color target
+	};
+	//Exponents used by EVSM. 16 bit floats overflow past e^11 for the squared moment.
+	const float EVSM_POSITIVE_EXPONENT = 5.0f;
+	const float EVSM_NEGATIVE_EXPONENT = 5.0f;
+
 	struct ShadowBuffer
 	{
 		unsigned int fbo;
 		unsigned int shadowMap;
 		unsigned int width;
 		unsigned int height;
+		int memoryId; //sh::trackGpuAllocation id
+		ShadowMode mode;
+		//Moment modes only. moments is what lighting samples, momentsTemp holds the horizontal blur pass.
+		unsigned int moments;
+		unsigned int momentsTemp;
 	};
-	ShadowBuffer createShadowBuffer(unsigned int width, unsigned int height);
+	ShadowBuffer createShadowBuffer(unsigned int width, unsigned int height, ShadowMode mode = ShadowMode::DEPTH);
+	//Sets up filtering and comparison on a depth texture (2D or array) for the given mode
+	void setShadowSampling(unsigned int texture, ShadowMode mode);
+	bool isMomentShadowMode(ShadowMode mode);
+	//Binds the shadow framebuffer, sets the viewport and clears depth, plus moments to the far plane
+	void beginShadowPass(const ShadowBuffer& buff);
+	//Separable blur of the moments over radius texels using the momentBlur compute shader, then
+	//rebuilds the mip chain. Only does something in moment modes.
+	void prefilterShadowMoments(const ShadowBuffer& buff, const ew::Shader& blurShader, int radius);
+	//The texture lighting should sample for this buffer's mode
+	unsigned int getShadowSampleTexture(const ShadowBuffer& buff);
 	void deleteShadowBuffer(ShadowBuffer buff);
 }
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include "textureArray.h"
+#include "gpuMemory.h"
+#include "../ew/texture.h"
+#include "../ew/external/stb_image.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace sh
+{
+	static bool isPowerOfTwo(int v)
+	{
+		return v > 0 && (v & (v - 1)) == 0;
+	}
+
+	RectPacker::RectPacker(unsigned int width, unsigned int height)
+	{
+		m_width = width;
+		m_height = height;
+		m_skyline.push_back({ 0, 0, width });
+	}
+
+	bool RectPacker::allocate(unsigned int width, unsigned int height, unsigned int* x, unsigned int* y)
+	{
+		//Find the skyline position where the rect sits lowest, breaking ties by narrowest fit
+		int bestIndex = -1;
+		unsigned int bestY = m_height;
+		unsigned int bestWidth = m_width;
+		for (size_t i = 0; i < m_skyline.size(); i++)
+		{
+			unsigned int startX = m_skyline[i].x;
+			if (startX + width > m_width)
+				break;
+
+			//Rect rests on the highest segment it spans
+			unsigned int top = 0;
+			unsigned int remaining = width;
+			size_t j = i;
+			while (remaining > 0 && j < m_skyline.size())
+			{
+				top = top > m_skyline[j].y ? top : m_skyline[j].y;
+				remaining = m_skyline[j].width >= remaining ? 0 : remaining - m_skyline[j].width;
+				j++;
+			}
+			if (top + height > m_height)
+				continue;
+			if (top < bestY || (top == bestY && m_skyline[i].width < bestWidth))
+			{
+				bestIndex = (int)i;
+				bestY = top;
+				bestWidth = m_skyline[i].width;
+			}
+		}
+		if (bestIndex < 0)
+			return false;
+
+		*x = m_skyline[bestIndex].x;
+		*y = bestY;
+
+		//Insert the new segment and trim everything it covers
+		Segment placed = { *x, bestY + height, width };
+		m_skyline.insert(m_skyline.begin() + bestIndex, placed);
+		size_t i = bestIndex + 1;
+		while (i < m_skyline.size())
+		{
+			Segment& s = m_skyline[i];
+			unsigned int placedEnd = placed.x + placed.width;
+			if (s.x >= placedEnd)
+				break;
+			unsigned int shrink = placedEnd - s.x;
+			if (s.width <= shrink)
+			{
+				m_skyline.erase(m_skyline.begin() + i);
+				continue;
+			}
+			s.x += shrink;
+			s.width -= shrink;
+			break;
+		}
+
+		//Merge neighbouring segments at the same height
+		for (size_t k = 0; k + 1 < m_skyline.size();)
+		{
+			if (m_skyline[k].y == m_skyline[k + 1].y)
+			{
+				m_skyline[k].width += m_skyline[k + 1].width;
+				m_skyline.erase(m_skyline.begin() + k + 1);
+			}
+			else
+			{
+				k++;
+			}
+		}
+		return true;
+	}
+
+	TextureArrayPacker::TextureArrayPacker(unsigned int atlasSize, unsigned int padding)
+	{
+		m_atlasSize = atlasSize;
+		m_padding = padding;
+	}
+
+	TextureArrayPacker::~TextureArrayPacker()
+	{
+		for (size_t i = 0; i < m_images.size(); i++)
+		{
+			stbi_image_free(m_images[i].data);
+		}
+	}
+
+	int TextureArrayPacker::addTexture(const char* filePath, bool repeat)
+	{
+		stbi_set_flip_vertically_on_load(true);
+		Image image;
+		image.repeat = repeat;
+		image.data = stbi_load(filePath, &image.width, &image.height, &image.numComponents, 0);
+		if (image.data == NULL) {
+			printf("Failed to load image %s", filePath);
+			image.width = image.height = 1;
+			image.numComponents = 4;
+			image.data = (unsigned char*)malloc(4);
+			memset(image.data, 255, 4);
+		}
+		m_images.push_back(image);
+		m_materials.push_back(MaterialTexture());
+		return (int)m_images.size() - 1;
+	}
+
+	void TextureArrayPacker::build()
+	{
+		//Group by size and format
+		std::map<std::tuple<int, int, int>, std::vector<int>> groups;
+		for (size_t i = 0; i < m_images.size(); i++)
+		{
+			const Image& image = m_images[i];
+			groups[std::make_tuple(image.width, image.height, image.numComponents)].push_back((int)i);
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		//Odd sizes (a lone non power of two texture) go to the atlas unless they repeat, everything else gets its own array
+		std::vector<int> atlasImages;
+		for (auto& group : groups)
+		{
+			const std::vector<int>& members = group.second;
+			const Image& first = m_images[members[0]];
+			bool fitsAtlas = first.width + 2 * m_padding <= m_atlasSize && first.height + 2 * m_padding <= m_atlasSize;
+			if (members.size() == 1 && fitsAtlas && !first.repeat && !(isPowerOfTwo(first.width) && isPowerOfTwo(first.height)))
+			{
+				atlasImages.push_back(members[0]);
+				continue;
+			}
+
+			TextureArray arr;
+			arr.width = first.width;
+			arr.height = first.height;
+			arr.layers = (unsigned int)members.size();
+			arr.internalFormat = ew::getSizedTextureFormat(first.numComponents);
+			arr.atlas = false;
+
+			glGenTextures(1, &arr.texture);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, arr.texture);
+			glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipLevelCount(arr.width, arr.height), arr.internalFormat, arr.width, arr.height, arr.layers);
+			for (size_t layer = 0; layer < members.size(); layer++)
+			{
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (int)layer, arr.width, arr.height, 1,
+					ew::getTextureFormat(first.numComponents), GL_UNSIGNED_BYTE, m_images[members[layer]].data);
+
+				MaterialTexture& material = m_materials[members[layer]];
+				material.arrayIndex = (unsigned int)m_arrays.size();
+				material.layer = (int)layer;
+			}
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			char name[64];
+			snprintf(name, sizeof(name), "Texture Array %dx%dx%d", arr.width, arr.height, arr.layers);
+			arr.memoryId = trackGpuAllocation(GpuMemoryCategory::TEXTURE, name,
+				textureBytes(arr.internalFormat, arr.width, arr.height, arr.layers, mipLevelCount(arr.width, arr.height)));
+			m_arrays.push_back(arr);
+		}
+
+		if (!atlasImages.empty())
+		{
+			//Place biggest first, opening a new page whenever the current ones are full
+			std::vector<int> sorted = atlasImages;
+			std::sort(sorted.begin(), sorted.end(), [&](int a, int b) {
+				return m_images[a].height > m_images[b].height;
+			});
+			std::vector<RectPacker> pages;
+			std::vector<glm::uvec3> placements(m_images.size());
+			for (size_t i = 0; i < sorted.size(); i++)
+			{
+				const Image& image = m_images[sorted[i]];
+				unsigned int w = image.width + 2 * m_padding;
+				unsigned int h = image.height + 2 * m_padding;
+				unsigned int x = 0, y = 0;
+				size_t page = 0;
+				for (; page < pages.size(); page++)
+				{
+					if (pages[page].allocate(w, h, &x, &y))
+						break;
+				}
+				if (page == pages.size())
+				{
+					pages.push_back(RectPacker(m_atlasSize, m_atlasSize));
+					pages.back().allocate(w, h, &x, &y);
+				}
+				placements[sorted[i]] = glm::uvec3(x + m_padding, y + m_padding, (unsigned int)page);
+			}
+
+			TextureArray arr;
+			arr.width = m_atlasSize;
+			arr.height = m_atlasSize;
+			arr.layers = (unsigned int)pages.size();
+			arr.internalFormat = GL_RGBA8;
+			arr.atlas = true;
+
+			//Only keep mips whose texels stay inside the padding so neighbours can't bleed in
+			int levels = 1;
+			for (unsigned int p = m_padding; p > 1; p >>= 1)
+				levels++;
+
+			glGenTextures(1, &arr.texture);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, arr.texture);
+			glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, arr.width, arr.height, arr.layers);
+			arr.memoryId = trackGpuAllocation(GpuMemoryCategory::TEXTURE, "Texture Atlas",
+				textureBytes(GL_RGBA8, arr.width, arr.height, arr.layers, levels));
+			std::vector<unsigned char> clear(4 * (size_t)m_atlasSize * m_atlasSize, 0);
+			for (unsigned int layer = 0; layer < arr.layers; layer++)
+			{
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, arr.width, arr.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, clear.data());
+			}
+
+			std::vector<unsigned char> rgba;
+			for (size_t i = 0; i < sorted.size(); i++)
+			{
+				const Image& image = m_images[sorted[i]];
+				glm::uvec3 place = placements[sorted[i]];
+
+				//Expand to RGBA with edge texels extruded into the padding
+				int paddedW = image.width + 2 * m_padding;
+				int paddedH = image.height + 2 * m_padding;
+				rgba.assign(4 * (size_t)paddedW * paddedH, 255);
+				for (int py = 0; py < paddedH; py++)
+				{
+					int sy = glm::clamp(py - (int)m_padding, 0, image.height - 1);
+					for (int px = 0; px < paddedW; px++)
+					{
+						int sx = glm::clamp(px - (int)m_padding, 0, image.width - 1);
+						const unsigned char* src = image.data + ((size_t)sy * image.width + sx) * image.numComponents;
+						unsigned char* dst = &rgba[((size_t)py * paddedW + px) * 4];
+						if (image.numComponents >= 3)
+						{
+							dst[0] = src[0];
+							dst[1] = src[1];
+							dst[2] = src[2];
+							dst[3] = image.numComponents == 4 ? src[3] : 255;
+						}
+						else
+						{
+							dst[0] = dst[1] = dst[2] = src[0];
+							dst[3] = image.numComponents == 2 ? src[1] : 255;
+						}
+					}
+				}
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, place.x - m_padding, place.y - m_padding, place.z, paddedW, paddedH, 1,
+					GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+				MaterialTexture& material = m_materials[sorted[i]];
+				material.arrayIndex = (unsigned int)m_arrays.size();
+				material.layer = (int)place.z;
+				material.uvScale = glm::vec2((float)image.width / m_atlasSize, (float)image.height / m_atlasSize);
+				material.uvOffset = glm::vec2((float)place.x / m_atlasSize, (float)place.y / m_atlasSize);
+			}
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			m_arrays.push_back(arr);
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		for (size_t i = 0; i < m_images.size(); i++)
+		{
+			stbi_image_free(m_images[i].data);
+			m_images[i].data = NULL;
+		}
+	}
+
+	void TextureArrayPacker::bind(unsigned int unit, unsigned int arrayIndex)
+	{
+		if (m_boundArray.size() <= unit)
+			m_boundArray.resize(unit + 1, -1);
+		if (m_boundArray[unit] == (int)arrayIndex)
+			return;
+		glBindTextureUnit(unit, m_arrays[arrayIndex].texture);
+		m_boundArray[unit] = (int)arrayIndex;
+	}
+
+	void TextureArrayPacker::invalidateBindings()
+	{
+		m_boundArray.clear();
+	}
+
+	void TextureArrayPacker::destroy()
+	{
+		for (size_t i = 0; i < m_arrays.size(); i++)
+		{
+			glDeleteTextures(1, &m_arrays[i].texture);
+			releaseGpuAllocation(m_arrays[i].memoryId);
+		}
+		m_arrays.clear();
+		m_boundArray.clear();
+	}
+}
@@ -0,0 +1,86 @@
+//sh/textureArray.h
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../ew/external/glad.h"
+namespace sh
+{
+	//Where a texture lives after packing. Materials hold this instead of a texture handle,
+	//so objects that share an array can be drawn without rebinding anything.
+	struct MaterialTexture
+	{
+		unsigned int arrayIndex = 0; //Index into TextureArrayPacker::getArrays()
+		int layer = 0; //Layer inside that GL_TEXTURE_2D_ARRAY
+		glm::vec2 uvScale = glm::vec2(1.0f);
+		glm::vec2 uvOffset = glm::vec2(0.0f);
+	};
+
+	struct TextureArray
+	{
+		unsigned int texture;
+		unsigned int width;
+		unsigned int height;
+		unsigned int layers;
+		int internalFormat;
+		bool atlas; //true if layers are atlas pages holding several sub-rects
+		int memoryId; //sh::trackGpuAllocation id
+	};
+
+	//Skyline bottom-left rectangle allocator used for atlas pages
+	class RectPacker
+	{
+	public:
+		RectPacker(unsigned int width, unsigned int height);
+		bool allocate(unsigned int width, unsigned int height, unsigned int* x, unsigned int* y);
+	private:
+		struct Segment
+		{
+			unsigned int x;
+			unsigned int y;
+			unsigned int width;
+		};
+		std::vector<Segment> m_skyline;
+		unsigned int m_width;
+		unsigned int m_height;
+	};
+
+	//Groups textures of the same size and format into GL_TEXTURE_2D_ARRAY layers.
+	//Textures that don't share a size with anything else are packed into atlas pages instead, as long
+	//as they were added without repeat. Atlas pages clamp to each sub-rect's edge, so UVs outside 0..1
+	//would stretch the edge texels instead of tiling.
+	class TextureArrayPacker
+	{
+	public:
+		TextureArrayPacker(unsigned int atlasSize = 2048, unsigned int padding = 4);
+		~TextureArrayPacker();
+		//Queues an image for packing. Returns a handle to look up its MaterialTexture after build()
+		//repeat = false allows the image into an atlas page, only for UVs that stay within 0..1
+		int addTexture(const char* filePath, bool repeat = true);
+		//Creates all arrays and uploads the queued images. CPU copies are released afterwards.
+		void build();
+		const MaterialTexture& getMaterialTexture(int handle) const { return m_materials[handle]; }
+		const std::vector<TextureArray>& getArrays() const { return m_arrays; }
+		//Binds array arrayIndex to the given texture unit, skipping the bind if it is already there
+		void bind(unsigned int unit, unsigned int arrayIndex);
+		//Call when other code may have bound textures to the units bind() tracks
+		void invalidateBindings();
+		void destroy();
+	private:
+		struct Image
+		{
+			unsigned char* data;
+			int width;
+			int height;
+			int numComponents;
+			bool repeat;
+		};
+		std::vector<Image> m_images;
+		std::vector<MaterialTexture> m_materials;
+		std::vector<TextureArray> m_arrays;
+		std::vector<int> m_boundArray; //arrayIndex currently bound per unit, -1 if unknown
+		unsigned int m_atlasSize;
+		unsigned int m_padding;
+	};
+}
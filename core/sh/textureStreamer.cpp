@@ -0,0 +1,331 @@
+#include "textureStreamer.h"
+#include "gpuMemory.h"
+#include "../ew/texture.h"
+#include "../ew/external/stb_image.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+namespace sh
+{
+	TextureStreamer::TextureStreamer(size_t budgetBytes, int uploadsPerFrame)
+	{
+		m_budgetBytes = budgetBytes;
+		m_uploadsPerFrame = uploadsPerFrame;
+	}
+
+	int TextureStreamer::addTexture(const char* filePath)
+	{
+		StreamedTexture tex;
+		snprintf(tex.name, sizeof(tex.name), "%s", filePath);
+		tex.texture = 0;
+		tex.lastUsedFrame = 0;
+		tex.memoryId = -1;
+
+		stbi_set_flip_vertically_on_load(true);
+		int width, height, numComponents;
+		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 0);
+		if (data == NULL) {
+			printf("Failed to load image %s", filePath);
+			width = height = 1;
+			numComponents = 4;
+			data = (unsigned char*)malloc(4);
+			memset(data, 255, 4);
+		}
+		tex.numComponents = numComponents;
+
+		//Build the whole mip chain on the CPU with a 2x2 box filter. This stands in for reading mips from disk.
+		MipLevel base;
+		base.width = width;
+		base.height = height;
+		base.pixels.assign(data, data + (size_t)width * height * numComponents);
+		stbi_image_free(data);
+		tex.mips.push_back(base);
+		while (tex.mips.back().width > 1 || tex.mips.back().height > 1)
+		{
+			const MipLevel& src = tex.mips.back();
+			MipLevel dst;
+			dst.width = src.width > 1 ? src.width / 2 : 1;
+			dst.height = src.height > 1 ? src.height / 2 : 1;
+			dst.pixels.resize((size_t)dst.width * dst.height * numComponents);
+			for (unsigned int y = 0; y < dst.height; y++)
+			{
+				unsigned int y0 = y * 2 < src.height ? y * 2 : src.height - 1;
+				unsigned int y1 = y * 2 + 1 < src.height ? y * 2 + 1 : src.height - 1;
+				for (unsigned int x = 0; x < dst.width; x++)
+				{
+					unsigned int x0 = x * 2 < src.width ? x * 2 : src.width - 1;
+					unsigned int x1 = x * 2 + 1 < src.width ? x * 2 + 1 : src.width - 1;
+					for (int c = 0; c < numComponents; c++)
+					{
+						unsigned int sum = src.pixels[((size_t)y0 * src.width + x0) * numComponents + c]
+							+ src.pixels[((size_t)y0 * src.width + x1) * numComponents + c]
+							+ src.pixels[((size_t)y1 * src.width + x0) * numComponents + c]
+							+ src.pixels[((size_t)y1 * src.width + x1) * numComponents + c];
+						dst.pixels[((size_t)y * dst.width + x) * numComponents + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+			tex.mips.push_back(dst);
+		}
+
+		//Start with only the coarse mips resident
+		tex.residentMip = (int)tex.mips.size();
+		tex.requestedMip = (int)tex.mips.size();
+		tex.wantedMip = coarsestResidentMip(tex);
+		m_textures.push_back(tex);
+		setResidentMip(m_textures.back(), coarsestResidentMip(tex));
+		return (int)m_textures.size() - 1;
+	}
+
+	void TextureStreamer::requestForObject(int handle, const glm::vec3& worldCenter, float worldRadius, float uvTiling,
+		const ew::Camera& camera, unsigned int screenHeight)
+	{
+		StreamedTexture& tex = m_textures[handle];
+		tex.lastUsedFrame = m_frame;
+
+		//Size of the object's bounding sphere on screen, in pixels
+		float projectedPixels;
+		float distance = glm::length(worldCenter - camera.position);
+		if (camera.orthographic)
+		{
+			projectedPixels = (2.0f * worldRadius) / camera.orthoHeight * screenHeight;
+		}
+		else
+		{
+			if (distance <= worldRadius)
+			{
+				tex.requestedMip = 0;
+				return;
+			}
+			float viewHeight = 2.0f * distance * tanf(glm::radians(camera.fov) * 0.5f);
+			projectedPixels = (2.0f * worldRadius) / viewHeight * screenHeight;
+		}
+
+		//Texels that land across those pixels. One texel per pixel is mip 0, two is mip 1, etc.
+		float texelsAcross = (float)glm::max(tex.mips[0].width, tex.mips[0].height) * uvTiling;
+		int mip = 0;
+		if (projectedPixels > 0.0f && texelsAcross > projectedPixels)
+		{
+			mip = (int)floorf(log2f(texelsAcross / projectedPixels));
+		}
+		mip = glm::clamp(mip, 0, (int)tex.mips.size() - 1);
+		if (mip < tex.requestedMip)
+			tex.requestedMip = mip;
+	}
+
+	size_t TextureStreamer::bytesFromMip(const StreamedTexture& tex, int mip) const
+	{
+		size_t bytes = 0;
+		for (size_t i = mip; i < tex.mips.size(); i++)
+		{
+			bytes += tex.mips[i].pixels.size();
+		}
+		return bytes;
+	}
+
+	int TextureStreamer::coarsestResidentMip(const StreamedTexture& tex) const
+	{
+		int mip = 0;
+		while (mip + 1 < (int)tex.mips.size()
+			&& (tex.mips[mip].width > m_minResidentSize || tex.mips[mip].height > m_minResidentSize))
+		{
+			mip++;
+		}
+		return mip;
+	}
+
+	void TextureStreamer::setResidentMip(StreamedTexture& tex, int mip)
+	{
+		if (mip == tex.residentMip)
+			return;
+
+		const MipLevel& top = tex.mips[mip];
+		int levels = (int)tex.mips.size() - mip;
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, levels, ew::getSizedTextureFormat(tex.numComponents), top.width, top.height);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int i = mip; i < (int)tex.mips.size(); i++)
+		{
+			const MipLevel& level = tex.mips[i];
+			if (tex.texture != 0 && i >= tex.residentMip)
+			{
+				//Already on the GPU, copy instead of uploading again
+				glCopyImageSubData(tex.texture, GL_TEXTURE_2D, i - tex.residentMip, 0, 0, 0,
+					texture, GL_TEXTURE_2D, i - mip, 0, 0, 0, level.width, level.height, 1);
+			}
+			else
+			{
+				glTexSubImage2D(GL_TEXTURE_2D, i - mip, 0, 0, level.width, level.height,
+					ew::getTextureFormat(tex.numComponents), GL_UNSIGNED_BYTE, level.pixels.data());
+			}
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		if (tex.texture != 0)
+			glDeleteTextures(1, &tex.texture);
+		tex.texture = texture;
+		tex.residentMip = mip;
+
+		if (tex.memoryId < 0)
+			tex.memoryId = trackGpuAllocation(GpuMemoryCategory::TEXTURE, tex.name, bytesFromMip(tex, mip));
+		else
+			resizeGpuAllocation(tex.memoryId, bytesFromMip(tex, mip));
+	}
+
+	void TextureStreamer::update()
+	{
+		m_uploadsThisFrame = 0;
+		m_evictionsThisFrame = 0;
+
+		size_t residentBytes = 0;
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			StreamedTexture& tex = m_textures[i];
+			if (tex.lastUsedFrame == m_frame && tex.requestedMip < (int)tex.mips.size())
+				tex.wantedMip = glm::min(tex.requestedMip, coarsestResidentMip(tex));
+			residentBytes += bytesFromMip(tex, tex.residentMip);
+		}
+
+		//Picks what to drop a level from: textures holding more than they want first, then least recently used.
+		//Textures in use this frame at their wanted level are only touched when forced.
+		auto findVictim = [&](int exclude, bool force) -> int {
+			int victim = -1;
+			for (size_t i = 0; i < m_textures.size(); i++)
+			{
+				const StreamedTexture& tex = m_textures[i];
+				if ((int)i == exclude || tex.residentMip >= coarsestResidentMip(tex))
+					continue;
+				bool surplus = tex.residentMip < tex.wantedMip;
+				if (!surplus && !force && tex.lastUsedFrame == m_frame)
+					continue;
+				if (victim < 0)
+				{
+					victim = (int)i;
+					continue;
+				}
+				const StreamedTexture& best = m_textures[victim];
+				bool bestSurplus = best.residentMip < best.wantedMip;
+				if (surplus != bestSurplus ? surplus : tex.lastUsedFrame < best.lastUsedFrame)
+					victim = (int)i;
+			}
+			return victim;
+		};
+		auto evict = [&](int index) {
+			StreamedTexture& tex = m_textures[index];
+			residentBytes -= bytesFromMip(tex, tex.residentMip) - bytesFromMip(tex, tex.residentMip + 1);
+			setResidentMip(tex, tex.residentMip + 1);
+			m_evictionsThisFrame++;
+		};
+
+		//Each upload streams one finer mip into whichever texture used this frame is furthest from its
+		//wanted mip, so a texture far behind can get several mips in one frame. Stops at the upload
+		//budget, or when the memory budget can't be met without evicting a texture that is needed.
+		for (int pass = 0; pass < (int)m_textures.size() && m_uploadsThisFrame < m_uploadsPerFrame; pass++)
+		{
+			int next = -1;
+			for (size_t i = 0; i < m_textures.size(); i++)
+			{
+				const StreamedTexture& tex = m_textures[i];
+				if (tex.residentMip <= tex.wantedMip || tex.lastUsedFrame != m_frame)
+					continue;
+				//Biggest shortfall first
+				if (next < 0 || tex.residentMip - tex.wantedMip > m_textures[next].residentMip - m_textures[next].wantedMip)
+					next = (int)i;
+			}
+			if (next < 0)
+				break;
+
+			StreamedTexture& tex = m_textures[next];
+			size_t extra = bytesFromMip(tex, tex.residentMip - 1) - bytesFromMip(tex, tex.residentMip);
+			bool fits = true;
+			while (residentBytes + extra > m_budgetBytes)
+			{
+				int victim = findVictim(next, false);
+				if (victim < 0)
+				{
+					fits = false;
+					break;
+				}
+				evict(victim);
+			}
+			if (!fits)
+				break;
+			setResidentMip(tex, tex.residentMip - 1);
+			residentBytes += extra;
+			m_uploadsThisFrame++;
+		}
+
+		//The budget may have shrunk since last frame
+		while (residentBytes > m_budgetBytes)
+		{
+			int victim = findVictim(-1, true);
+			if (victim < 0)
+				break;
+			evict(victim);
+		}
+
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			m_textures[i].requestedMip = (int)m_textures[i].mips.size();
+		}
+		m_frame++;
+	}
+
+	StreamingStats TextureStreamer::getStats() const
+	{
+		StreamingStats stats;
+		stats.budgetBytes = m_budgetBytes;
+		stats.residentBytes = 0;
+		stats.requestedBytes = 0;
+		stats.fullBytes = 0;
+		stats.textureCount = (int)m_textures.size();
+		stats.pendingTextures = 0;
+		stats.uploadsThisFrame = m_uploadsThisFrame;
+		stats.evictionsThisFrame = m_evictionsThisFrame;
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			const StreamedTexture& tex = m_textures[i];
+			stats.residentBytes += bytesFromMip(tex, tex.residentMip);
+			stats.requestedBytes += bytesFromMip(tex, tex.wantedMip);
+			stats.fullBytes += bytesFromMip(tex, 0);
+			if (tex.residentMip > tex.wantedMip)
+				stats.pendingTextures++;
+		}
+		return stats;
+	}
+
+	StreamedTextureInfo TextureStreamer::getTextureInfo(int handle) const
+	{
+		const StreamedTexture& tex = m_textures[handle];
+		StreamedTextureInfo info;
+		info.name = tex.name;
+		info.width = tex.mips[0].width;
+		info.height = tex.mips[0].height;
+		info.residentMip = tex.residentMip;
+		info.requestedMip = tex.wantedMip;
+		info.residentBytes = bytesFromMip(tex, tex.residentMip);
+		info.lastUsedFrame = tex.lastUsedFrame;
+		return info;
+	}
+
+	void TextureStreamer::destroy()
+	{
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			glDeleteTextures(1, &m_textures[i].texture);
+			m_textures[i].texture = 0;
+			releaseGpuAllocation(m_textures[i].memoryId);
+			m_textures[i].memoryId = -1;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+//sh/textureStreamer.h
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../ew/external/glad.h"
+#include "../ew/camera.h"
+namespace sh
+{
+	struct StreamingStats
+	{
+		size_t budgetBytes;
+		size_t residentBytes; //What is on the GPU right now
+		size_t requestedBytes; //What would be on the GPU if every request was met
+		size_t fullBytes; //Everything at full resolution
+		int textureCount;
+		int pendingTextures; //Textures whose resident mip is coarser than requested
+		int uploadsThisFrame;
+		int evictionsThisFrame;
+	};
+
+	struct StreamedTextureInfo
+	{
+		const char* name;
+		unsigned int width;
+		unsigned int height;
+		int residentMip;
+		int requestedMip;
+		size_t residentBytes;
+		unsigned int lastUsedFrame;
+	};
+
+	//Keeps every texture's mip chain in system memory and only the mips the camera needs on the GPU.
+	//Textures start at their coarse mips and stream in finer ones a level at a time; when the
+	//VRAM budget is exceeded the least recently used textures drop their finest mips first.
+	//Resident mips are changed by re-allocating the texture storage, so getTexture() may
+	//return a different handle after update().
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer(size_t budgetBytes = 64 * 1024 * 1024, int uploadsPerFrame = 2);
+		int addTexture(const char* filePath);
+		//Estimates the screen-space texel density of an object using this texture and records the mip it needs.
+		//uvTiling is how many times the texture repeats across the object's bounding diameter.
+		void requestForObject(int handle, const glm::vec3& worldCenter, float worldRadius, float uvTiling,
+			const ew::Camera& camera, unsigned int screenHeight);
+		//Applies this frame's requests: uploads finer mips within the budget and evicts least recently used ones
+		void update();
+		unsigned int getTexture(int handle) const { return m_textures[handle].texture; }
+		void setBudget(size_t budgetBytes) { m_budgetBytes = budgetBytes; }
+		//Mips coarser than this many pixels are always kept resident
+		void setMinResidentSize(unsigned int size) { m_minResidentSize = size; }
+		StreamingStats getStats() const;
+		int getTextureCount() const { return (int)m_textures.size(); }
+		StreamedTextureInfo getTextureInfo(int handle) const;
+		void destroy();
+	private:
+		struct MipLevel
+		{
+			unsigned int width;
+			unsigned int height;
+			std::vector<unsigned char> pixels;
+		};
+		struct StreamedTexture
+		{
+			char name[128];
+			std::vector<MipLevel> mips;
+			int numComponents;
+			unsigned int texture;
+			int residentMip;
+			int requestedMip; //Finest mip asked for this frame, mips.size() if nobody asked
+			int wantedMip; //Level streamed toward. Follows requestedMip on frames the texture is used, keeps its last value while unused.
+			unsigned int lastUsedFrame;
+			int memoryId; //sh::trackGpuAllocation id, -1 until first resident
+		};
+		size_t bytesFromMip(const StreamedTexture& tex, int mip) const;
+		int coarsestResidentMip(const StreamedTexture& tex) const;
+		void setResidentMip(StreamedTexture& tex, int mip);
+
+		std::vector<StreamedTexture> m_textures;
+		size_t m_budgetBytes;
+		int m_uploadsPerFrame;
+		unsigned int m_minResidentSize = 64;
+		unsigned int m_frame = 0;
+		int m_uploadsThisFrame = 0;
+		int m_evictionsThisFrame = 0;
+	};
+}